@@ -1,23 +1,77 @@
 #include <tensorflow/lite/c/common.h>
 
+#include "audio_source.h"
+
 #pragma once
 
-TfLiteStatus init_audio_recording();
-
-// Expected to return 16-bit PCM sample data for a given point in time. The
-// sample data itself should be used as quickly as possible by the caller, since
-// to allow memory optimizations there are no guarantees that the samples won't
-// be overwritten by new data in the future. In practice, implementations should
-// ensure that there's a reasonable time allowed for clients to access the data
-// before any reuse.
-TfLiteStatus get_audio_samples(
-    size_t start_ms, 
-    size_t duration_ms,
-    size_t &audio_samples_size, 
-    int16_t **audio_samples);
-
-// Returns the time that audio data was last captured in milliseconds. There's
-// no contract about what time zero represents, the accuracy, or the granularity
-// of the result. Subsequent calls will generally not return a lower value, but
-// even that's not guaranteed if there's an overflow wraparound.
-int32_t get_latest_audio_timestamp();
\ No newline at end of file
+// How much history the capture ring holds.
+constexpr size_t AUDIO_CAPTURE_SAMPLES = AUDIO_BLOCK_SAMPLES * 32;
+
+// Starts capturing from the given source, which must outlive the recording, and
+// waits for the first samples.
+TfLiteStatus init_audio_recording(AudioSource &source_);
+
+// All positions below are on the audio sample clock: the index of a sample in the
+// history of all samples captured since recording started.
+
+// View into the capture ring for a window of samples. The window is returned as
+// up to two contiguous spans: the second one is only non-empty when the window
+// wraps around the end of the ring.
+struct AudioSamplesView {
+    int64_t start = 0;  // Position of the first sample.
+    const int16_t *first = nullptr;
+    size_t first_size = 0;
+    const int16_t *second = nullptr;
+    size_t second_size = 0;
+
+    size_t size() const     { return first_size + second_size; }
+    bool contiguous() const { return !second_size; }
+};
+
+// Lets the caller read a window of samples in place, without copying them. The
+// samples should be used as quickly as possible, the producer overwrites the oldest
+// ones as new audio arrives. Fails if the window is not in the ring (yet or anymore).
+TfLiteStatus get_audio_samples_view(
+    int64_t start_sample, 
+    size_t sample_count,
+    AudioSamplesView &view);
+
+// Must be called once the samples of a view have been consumed. Returns false if
+// the producer overwrote any of them in the meantime, in which case whatever was
+// computed from the view should be discarded.
+bool audio_samples_intact(const AudioSamplesView &view);
+
+// Lets the producer know that the samples before sample are not needed, without
+// reading them. For a reader that skips audio on purpose, so that what it skips is not
+// counted as dropped. Samples that are still in the ring can be read afterwards.
+void release_audio_samples(int64_t sample);
+
+// Capture health counters. An overrun is a window lost because it was overwritten
+// before or while it was read, a dropped block is a block of samples overwritten
+// before the reader got to it.
+struct AudioStats {
+    uint32_t overruns;
+    uint32_t dropped_blocks;
+};
+
+AudioStats get_audio_stats();
+
+// Returns how many samples have been captured since voice activity was last
+// detected. Saturates instead of wrapping.
+uint32_t get_silent_samples();
+
+// Called from the capture context, the PDM interrupt on the device, each time the
+// captured audio completes another feature stride. Must be interrupt safe and quick,
+// typically it just wakes up whatever turns the new samples into slices. Pass
+// nullptr to stop the calls.
+using AudioStrideHandler = void (*)(void *context);
+
+void set_audio_stride_handler(AudioStrideHandler handler, void *context);
+
+// Polls the source and returns the position one past the last captured sample. The 64-bit counter
+// never wraps in practice, so subsequent calls never return a lower value.
+int64_t get_latest_audio_sample();
+
+// Same position without polling the source, for threads other than the one that drives
+// it. Safe to call concurrently with the capture.
+int64_t get_captured_audio_sample();
\ No newline at end of file
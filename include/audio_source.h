@@ -0,0 +1,31 @@
+#include <tensorflow/lite/c/common.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#pragma once
+
+// Samples are produced in blocks of this size. Matches one PDM buffer on the board.
+constexpr size_t AUDIO_BLOCK_SAMPLES = 256;
+
+// Source of 16 kHz mono 16-bit PCM for the audio provider. Implementations only
+// produce blocks with begin_audio_block()/end_audio_block(), either from an
+// interrupt or from poll(). The provider owns the capture ring, the voice activity
+// detection and the counters, so every source behaves the same downstream.
+class AudioSource {
+public:
+    virtual ~AudioSource() = default;
+
+    // Starts producing samples.
+    virtual TfLiteStatus begin() = 0;
+    // Gives sources without an interrupt of their own a chance to produce samples.
+    // Called by the provider whenever the latest sample is queried.
+    virtual void poll() {}
+    // Whether the source has run out of samples for good.
+    virtual bool finished() const { return false; }
+};
+
+// Producer side of the capture ring. Returns where to write the next block of
+// AUDIO_BLOCK_SAMPLES samples, which is published by end_audio_block().
+int16_t* begin_audio_block();
+void end_audio_block();
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include <chrono>
+#include <cstdio>
+
+#include "audio_source.h"
+
+#pragma once
+
+// Host replay of recorded audio from a 16 kHz mono 16-bit WAV file, raw
+// little-endian PCM, or stdin. Either paced to real time, as if it came from a
+// microphone, or as fast as the consumer polls, to measure the real-time factor.
+class FileAudioSource : public AudioSource {
+public:
+    enum class Format {
+        WAV,
+        RAW,
+    };
+    enum class Pacing {
+        REAL_TIME,
+        FAST,
+    };
+
+    // Takes ownership of the file, stdin is left open.
+    FileAudioSource(FILE *file_, Format format_, Pacing pacing_, size_t fast_chunk_ = default_fast_chunk) 
+        : file(file_), format(format_), pacing(pacing_), fast_chunk(fast_chunk_) 
+    {}
+    ~FileAudioSource() override;
+
+    TfLiteStatus begin() override;
+    void poll() override;
+    bool finished() const override { return eof; }
+private:
+    // How much audio one poll produces without pacing: one 200 ms inference period.
+    static constexpr size_t default_fast_chunk = 3200;
+
+    TfLiteStatus parse_wav_header();
+    void produce_block();
+
+    FILE *file;
+    Format format;
+    Pacing pacing;
+    size_t fast_chunk;
+    bool eof = false;
+    size_t data_left = SIZE_MAX;    // Bytes of sample data left, known for WAV only.
+    uint64_t blocks_produced = 0;
+    uint64_t due_samples = 0;       // Samples that should have been produced by now.
+    std::chrono::steady_clock::time_point start_time;
+};
\ No newline at end of file
@@ -0,0 +1,9 @@
+#include "audio_source.h"
+
+#pragma once
+
+// Microphone of the board, read from the PDM interrupt.
+class PdmAudioSource : public AudioSource {
+public:
+    TfLiteStatus begin() override;
+};
\ No newline at end of file
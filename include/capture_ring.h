@@ -0,0 +1,100 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#pragma once
+
+// Lock-free single-producer/single-consumer ring for audio samples. Every sample has
+// a position in the history of all samples (its sequence number). The producer never
+// blocks, it overwrites the oldest samples, so readers validate after use that the
+// window they read was not overwritten meanwhile. Sequence numbers are 32-bit and
+// compared modulo 2^32, which is fine as long as readers stay within 2^31 samples.
+// The full 64-bit count of written samples is available through write_sequence64().
+template<class T, size_t N>
+class CaptureRing {
+    static_assert(N && !(N & (N - 1)), "Capacity must be a power of two");
+
+    static constexpr uint32_t mask = N - 1;
+
+    T buf[N] = {};
+    std::atomic<uint32_t> write_begin{0};   // End of the block currently being written.
+    std::atomic<uint32_t> write_end{0};     // End of the last completely written block.
+    std::atomic<uint32_t> write_epoch{0};   // How many times write_end wrapped around 2^32.
+    std::atomic<uint32_t> epoch_version{0}; // Odd while write_end and write_epoch are updated.
+    std::atomic<uint32_t> read_seq{0};      // First sample the consumer still needs.
+    std::atomic<bool> reading{false};       // Whether the consumer has released anything yet.
+    std::atomic<uint32_t> dropped_blocks{0};
+    std::atomic<uint32_t> overruns{0};
+public:
+    // Producer: returns where to write the next count samples. The ring capacity
+    // must be a multiple of the block size, so that blocks never wrap.
+    T* prepare(size_t count)
+    {
+        const uint32_t end = write_end.load(std::memory_order_relaxed);
+        const uint32_t begin = end + count;
+
+        // Old samples the consumer has not read yet are about to be overwritten.
+        if (reading.load(std::memory_order_relaxed) && begin - read_seq.load(std::memory_order_relaxed) > N)
+            dropped_blocks.fetch_add(1, std::memory_order_relaxed);
+
+        write_begin.store(begin, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return &buf[end & mask];
+    }
+    // Producer: publishes the block returned by prepare().
+    void commit(size_t count)
+    {
+        const uint32_t end = write_end.load(std::memory_order_relaxed) + count;
+        const uint32_t version = epoch_version.load(std::memory_order_relaxed);
+
+        epoch_version.store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        if (end < count)
+            write_epoch.store(write_epoch.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        write_end.store(end, std::memory_order_release);
+        epoch_version.store(version + 2, std::memory_order_release);
+    }
+    // Sequence number one past the newest completely written sample.
+    uint32_t write_sequence() const { return write_end.load(std::memory_order_acquire); }
+    // Same as write_sequence(), but never wraps. Retries if the producer interrupts it.
+    uint64_t write_sequence64() const
+    {
+        uint32_t version, epoch, end;
+        do {
+            version = epoch_version.load(std::memory_order_acquire);
+            epoch = write_epoch.load(std::memory_order_relaxed);
+            end = write_end.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((version & 1) || version != epoch_version.load(std::memory_order_relaxed));
+
+        return static_cast<uint64_t>(epoch) << 32 | end;
+    }
+    // Address of the sample with the given sequence number. No checks are made.
+    const T* at(uint32_t seq) const { return &buf[seq & mask]; }
+    // Whether count samples starting from start have been written and are still in the ring.
+    bool readable(uint32_t start, size_t count) const
+    {
+        const uint32_t end = write_end.load(std::memory_order_acquire);
+        return end - start >= count && end - start <= N && intact(start);
+    }
+    // Call after reading: true if nothing from start onwards has been overwritten so far.
+    bool intact(uint32_t start) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return write_begin.load(std::memory_order_relaxed) - start <= N;
+    }
+    // Consumer: samples before seq are no longer needed.
+    void release(uint32_t seq)
+    {
+        const uint32_t prev = read_seq.load(std::memory_order_relaxed);
+        if (!reading.load(std::memory_order_relaxed) || static_cast<int32_t>(seq - prev) > 0)
+            read_seq.store(seq, std::memory_order_relaxed);
+        reading.store(true, std::memory_order_relaxed);
+    }
+    // Consumer: a window was lost because it was overwritten before or while it was read.
+    void note_overrun() { overruns.fetch_add(1, std::memory_order_relaxed); }
+
+    uint32_t overrun_count() const          { return overruns.load(std::memory_order_relaxed); }
+    uint32_t dropped_block_count() const    { return dropped_blocks.load(std::memory_order_relaxed); }
+    size_t constexpr capacity() const       { return N; }
+};
@@ -4,17 +4,27 @@
 
 #pragma once
 
+// Keeps the spectrogram as a circular store of slices, so that new slices are
+// written once in place of the oldest ones instead of shifting the whole history.
+// The store is owned by the caller and holds FEATURE_ELEMENT_COUNT features, the
+// model reads a time-ordered copy of it published through the SpectrogramExchange.
 class FeatureProvider {
 public:
-    FeatureProvider(Array<int8_t, FEATURE_ELEMENT_COUNT> &feature_data_) 
+    FeatureProvider(int8_t *feature_data_) 
         : feature_data(feature_data_) 
     {}
 
-    int populate_feature_data(
-        int32_t last_time_in_ms, 
-        int32_t time_in_ms) const;
+    // Streams the samples captured since the previous call, up to the given position on
+    // the audio sample clock, through the frontend. Returns the number of new slices.
+    int populate_feature_data(int64_t sample);
+    // Writes the spectrogram to dst in time order, oldest slice first.
+    void copy_to(int8_t *dst) const;
 private:
-    void shift_slices(const size_t slices_to_keep) const;
-    
-    Array<int8_t, FEATURE_ELEMENT_COUNT> &feature_data;
+    int stream_samples(const int16_t *samples, size_t count);
+    void push_silent_slices(size_t count);
+
+    int8_t *feature_data;
+    size_t head = 0;            // Oldest slice, which the next new slice replaces.
+    int64_t next_sample = 0;    // First sample not yet streamed through the frontend.
+    bool started = false;
 };
\ No newline at end of file
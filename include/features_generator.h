@@ -1,7 +1,52 @@
 #include <tensorflow/lite/c/common.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/frontend.h>
+
+#include "frontend_fft.h"
+#include "model_settings.h"
 
 #pragma once
 
+// Size of a frontend snapshot: header, noise estimates and the window overlap.
+constexpr size_t FEATURE_SNAPSHOT_HEADER_SIZE = 16;
+constexpr size_t FEATURE_SNAPSHOT_SIZE = FEATURE_SNAPSHOT_HEADER_SIZE + 
+    FEATURE_SLICE_SIZE * sizeof(uint32_t) + 
+    FEATURE_SLICE_DURATION_SAMPLES * sizeof(int16_t);
+
+// Feature generation pipeline for one audio stream, holding its own frontend
+// state. Instances share nothing, so several streams can be featurized
+// concurrently, one instance per thread, without locks. The functions below
+// operate on a default instance.
+class FeatureExtractor {
+public:
+    FeatureExtractor() = default;
+    FeatureExtractor(const FeatureExtractor&) = delete;
+    FeatureExtractor& operator=(const FeatureExtractor&) = delete;
+    ~FeatureExtractor();
+
+    // See init_micro_features() and the others below.
+    TfLiteStatus init();
+    TfLiteStatus generate(
+        const int16_t *input, int input_size,
+        int output_size, int8_t *output,
+        size_t *num_samples_read);
+    TfLiteStatus stream(
+        const int16_t *input, size_t input_size,
+        int8_t *output, size_t max_slices,
+        size_t *num_slices, size_t *num_samples_read);
+    void restart_window();
+    // Not synchronized with stream(): call from the thread that streams, between two
+    // calls, or while nothing streams. The same goes for restore().
+    size_t snapshot(uint8_t *data, size_t size) const;
+    TfLiteStatus restore(const uint8_t *data, size_t size);
+    // Presets the noise reduction, for testing.
+    void set_noise_estimates(const uint32_t *estimate_presets);
+private:
+    FrontendState state = {};
+    FrontendFft fft;
+    bool initialized = false;
+    bool is_first_time = true;
+};
+
 // Sets up any resources needed for the feature generation pipeline.
 TfLiteStatus init_micro_features();
 
@@ -10,4 +55,30 @@ TfLiteStatus init_micro_features();
 TfLiteStatus generate_micro_features(
     const int16_t *input, int input_size,
     int output_size, int8_t *output,
-    size_t *num_samples_read);
\ No newline at end of file
+    size_t *num_samples_read);
+
+// Streaming alternative to generate_micro_features(): accepts any number of new
+// samples and writes a slice to output for every window step they complete. The
+// window overlap is kept in the frontend state, so each sample is read exactly once.
+// Stops early once max_slices have been written, num_samples_read tells how far it
+// got. Don't mix with generate_micro_features(), they share the frontend state.
+TfLiteStatus stream_micro_features(
+    const int16_t *input, size_t input_size,
+    int8_t *output, size_t max_slices,
+    size_t *num_slices, size_t *num_samples_read);
+
+// Drops the partially filled window, so that the next slice is computed only from
+// samples streamed after this call. Noise estimates are kept.
+void restart_micro_features_window();
+
+// Serializes the adaptive frontend state (noise estimates, which also drive the PCAN
+// gains, and the samples of the partially filled window) into a versioned little-endian
+// blob of FEATURE_SNAPSHOT_SIZE bytes. Returns the number of bytes written, 0 if size
+// is too small. On the device only the feature thread may call it, between two
+// populate_feature_data() calls, or before the pipeline threads start.
+size_t snapshot_micro_features(uint8_t *data, size_t size);
+
+// Restores a snapshot taken with the same frontend configuration, so that features
+// don't have to re-converge after a reboot or when resuming a stream. Fails without
+// touching the state if the blob is malformed, from another version or another config.
+TfLiteStatus restore_micro_features(const uint8_t *data, size_t size);
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include <cstddef>
+#include <cstdint>
+
+#pragma once
+
+// Converts frontend output (uint16, roughly 0 to 670) to model input (int8).
+//
+// These scaling values are derived from those used in input_data.py in the
+// training pipeline. In training, the features are arbitrarily divided by 25.6
+// to get float values in the rough range of 0.0 to 26.0, and the quantized
+// model then scales those to the -128 to 127 signed integer numbers:
+// input = (((feature / 25.6) / 26.0) * 256) - 128
+// In 32-bit integer math, with rounding, that is:
+// input = (feature * 256 + 333) / 666 - 128, clamped to int8.
+//
+// Division is slow and doesn't vectorize, so the kernels use a reciprocal
+// multiply instead: input = (min(feature, 1023) * 25191 + 32677) >> 16, which is
+// bit-exact with the formula above for every uint16 input, as checked at compile
+// time below. Anything above 1023 saturates to 127 either way. The constants fit
+// in int16, so one 16x16 dual multiply-add (SMUAD, pmaddwd) computes it.
+namespace features_quantizer {
+
+constexpr int32_t value_scale = 256;
+constexpr int32_t value_div = static_cast<int32_t>((25.6f * 26.0f) + 0.5f);
+
+constexpr uint32_t max_input = 1023;
+constexpr int32_t multiplier = 25191;
+constexpr int32_t rounding = 32677;
+constexpr int shift = 16;
+
+constexpr int8_t clamp_int8(int32_t value) 
+{ 
+    return value < -128 ? -128 : value > 127 ? 127 : value; 
+}
+
+// The original formula.
+constexpr int8_t quantize_reference(uint16_t feature)
+{
+    return clamp_int8(((feature * value_scale) + (value_div / 2)) / value_div - 128);
+}
+
+// Scalar fallback of the kernels.
+constexpr int8_t quantize_scalar(uint16_t feature)
+{
+    return clamp_int8((((feature < max_input ? feature : max_input) * multiplier + rounding) >> shift) - 128);
+}
+
+constexpr bool matches_reference()
+{
+    for (uint32_t feature = 0; feature <= UINT16_MAX; ++feature) {
+        if (quantize_scalar(feature) != quantize_reference(feature))
+            return false;
+    }
+    return true;
+}
+
+static_assert(value_div == 666, "Reciprocal constants are derived for a divisor of 666");
+static_assert(matches_reference(), "Reciprocal quantization must be bit-exact with the division");
+
+} // namespace features_quantizer
+
+// Quantizes count features to int8. Uses Cortex-M4 DSP instructions, SSE2 or
+// NEON when available, the scalar fallback otherwise.
+void quantize_features(const uint16_t *features, size_t count, int8_t *output);
\ No newline at end of file
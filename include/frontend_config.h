@@ -0,0 +1,108 @@
+#include <tensorflow/lite/experimental/microfrontend/lib/frontend.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/frontend_util.h>
+
+#include "model_settings.h"
+
+#pragma once
+
+// Parameters of the microfrontend. Window, channels and sample rate must match the
+// model, the rest are the values the model was trained with.
+struct FrontendParams {
+    size_t sample_rate;
+    size_t window_size_ms;
+    size_t window_step_ms;
+    int num_channels;
+    float lower_band_limit;
+    float upper_band_limit;
+    int smoothing_bits;
+    float even_smoothing;
+    float odd_smoothing;
+    float min_signal_remaining;
+    int enable_pcan;
+    float pcan_strength;
+    float pcan_offset;
+    int pcan_gain_bits;
+    int enable_log;
+    int log_scale_shift;
+};
+
+constexpr FrontendParams FRONTEND_PARAMS = {
+    AUDIO_SAMPLE_FREQUENCY,
+    FEATURE_SLICE_DURATION_MS,
+    FEATURE_SLICE_STRIDE_MS,
+    FEATURE_SLICE_SIZE,
+    125.0f,
+    7500.0f,
+    10,
+    0.025f,
+    0.06f,
+    0.05f,
+    1,
+    0.95f,
+    80.0f,
+    21,
+    1,
+    6,
+};
+
+constexpr bool operator==(const FrontendParams &a, const FrontendParams &b)
+{
+    return  a.sample_rate == b.sample_rate &&
+            a.window_size_ms == b.window_size_ms &&
+            a.window_step_ms == b.window_step_ms &&
+            a.num_channels == b.num_channels &&
+            a.lower_band_limit == b.lower_band_limit &&
+            a.upper_band_limit == b.upper_band_limit &&
+            a.smoothing_bits == b.smoothing_bits &&
+            a.even_smoothing == b.even_smoothing &&
+            a.odd_smoothing == b.odd_smoothing &&
+            a.min_signal_remaining == b.min_signal_remaining &&
+            a.enable_pcan == b.enable_pcan &&
+            a.pcan_strength == b.pcan_strength &&
+            a.pcan_offset == b.pcan_offset &&
+            a.pcan_gain_bits == b.pcan_gain_bits &&
+            a.enable_log == b.enable_log &&
+            a.log_scale_shift == b.log_scale_shift;
+}
+
+static_assert(FRONTEND_PARAMS.num_channels == FEATURE_SLICE_SIZE, "One channel per feature");
+static_assert(FRONTEND_PARAMS.window_step_ms * AUDIO_SAMPLES_PER_MS == FEATURE_SLICE_STRIDE_SAMPLES, "Window step must be the slice stride");
+static_assert(FRONTEND_PARAMS.window_size_ms * AUDIO_SAMPLES_PER_MS == FEATURE_SLICE_DURATION_SAMPLES, "Window must be the slice duration");
+static_assert(FRONTEND_PARAMS.window_step_ms <= FRONTEND_PARAMS.window_size_ms, "Windows must not leave gaps");
+static_assert(!(MAX_AUDIO_SAMPLE_SIZE & (MAX_AUDIO_SAMPLE_SIZE - 1)), "FFT size must be a power of two");
+static_assert(FEATURE_SLICE_DURATION_SAMPLES <= MAX_AUDIO_SAMPLE_SIZE &&
+    FEATURE_SLICE_DURATION_SAMPLES > MAX_AUDIO_SAMPLE_SIZE / 2, "FFT size must be the next power of two of the window");
+static_assert(FRONTEND_PARAMS.lower_band_limit > 0 &&
+    FRONTEND_PARAMS.lower_band_limit < FRONTEND_PARAMS.upper_band_limit &&
+    FRONTEND_PARAMS.upper_band_limit <= FRONTEND_PARAMS.sample_rate / 2, "Filterbank must fit below Nyquist");
+
+// Library config for FRONTEND_PARAMS, anything not covered keeps the library defaults.
+inline FrontendConfig make_frontend_config()
+{
+    FrontendConfig config;
+    FrontendFillConfigWithDefaults(&config);
+    config.window.size_ms = FRONTEND_PARAMS.window_size_ms;
+    config.window.step_size_ms = FRONTEND_PARAMS.window_step_ms;
+    config.filterbank.num_channels = FRONTEND_PARAMS.num_channels;
+    config.filterbank.lower_band_limit = FRONTEND_PARAMS.lower_band_limit;
+    config.filterbank.upper_band_limit = FRONTEND_PARAMS.upper_band_limit;
+    config.noise_reduction.smoothing_bits = FRONTEND_PARAMS.smoothing_bits;
+    config.noise_reduction.even_smoothing = FRONTEND_PARAMS.even_smoothing;
+    config.noise_reduction.odd_smoothing = FRONTEND_PARAMS.odd_smoothing;
+    config.noise_reduction.min_signal_remaining = FRONTEND_PARAMS.min_signal_remaining;
+    config.pcan_gain_control.enable_pcan = FRONTEND_PARAMS.enable_pcan;
+    config.pcan_gain_control.strength = FRONTEND_PARAMS.pcan_strength;
+    config.pcan_gain_control.offset = FRONTEND_PARAMS.pcan_offset;
+    config.pcan_gain_control.gain_bits = FRONTEND_PARAMS.pcan_gain_bits;
+    config.log_scale.enable_log = FRONTEND_PARAMS.enable_log;
+    config.log_scale.scale_shift = FRONTEND_PARAMS.log_scale_shift;
+    return config;
+}
+
+// Sets up the frontend state for FRONTEND_PARAMS. When include/frontend_tables.h has
+// been generated (see tools/gen_frontend_tables.cpp), the constant tables point into
+// flash and only the working buffers are allocated. Otherwise FrontendPopulateState()
+// computes them on the heap. Returns false on failure, the state must be freed with
+// free_frontend_state() either way.
+bool populate_frontend_state(FrontendState *state);
+void free_frontend_state(FrontendState *state);
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include <tensorflow/lite/c/common.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/frontend.h>
+
+#if defined(VOICE_CMD_FFT_CMSIS)
+#include <arm_math.h>
+#endif
+
+#include "model_settings.h"
+
+#pragma once
+
+// The FFT takes most of the time per slice, so the feature generator runs the
+// microfrontend with an FFT backend chosen at compile time:
+//   VOICE_CMD_FFT_CMSIS  CMSIS-DSP arm_rfft_q15, for Cortex-M devices.
+//   (default)            kissfft from the microfrontend library.
+// Backends scale their output like kissfft, so the rest of the frontend and the
+// model see the same range whatever the backend. The host has no backend of its own,
+// it only runs the tools, which use kissfft as the reference the others compare to.
+
+// Working memory of the backend for one frontend state. Each FeatureExtractor owns
+// one, so that streams share nothing.
+struct FrontendFft {
+#if defined(VOICE_CMD_FFT_CMSIS)
+    arm_rfft_instance_q15 rfft;
+    // arm_rfft_q15() writes the full complex spectrum.
+    q15_t output[2 * MAX_AUDIO_SAMPLE_SIZE];
+#endif
+};
+
+// Prepares the backend for the FFT size of the given frontend state, and checks that
+// it scales its output like kissfft. The state's FFT buffers are used for the check.
+TfLiteStatus init_frontend_fft(FrontendFft &fft, FrontendState &state);
+
+// Same contract as FrontendProcessSamples(), using the selected FFT backend.
+FrontendOutput frontend_process_samples(
+    FrontendFft &fft,
+    FrontendState *state, 
+    const int16_t *samples, 
+    size_t num_samples, 
+    size_t *num_samples_read);
\ No newline at end of file
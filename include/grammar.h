@@ -0,0 +1,129 @@
+#include <cstddef>
+#include <cstdint>
+
+#include "misc.h"
+
+#pragma once
+
+// Commands made of several keywords, numbered after the single-label commands.
+enum : uint8_t {
+    ON_OFF = N_LABELS,
+    OFF_ON,
+    N_COMMANDS // Don't modify, leave at the end of the enum.
+};
+
+constexpr const char *SEQUENCES[N_COMMANDS - N_LABELS] = {
+    "on off",
+    "off on"
+};
+
+constexpr const char* command_name(uint8_t cmd)
+{
+    return cmd < N_LABELS ? LABELS[cmd] : SEQUENCES[cmd - N_LABELS];
+}
+
+constexpr size_t MAX_RULE_WORDS = 4;
+constexpr uint8_t NO_COMMAND = UINT8_MAX;
+
+// Keywords that make up a command, each within max_gap of the previous one. Words end
+// at the first SILENCE, which is never a word itself.
+struct GrammarRule {
+    uint8_t command;
+    int64_t max_gap;
+    uint8_t words[MAX_RULE_WORDS];
+};
+
+// The command set. A word completing a rule is reported at once, even if it may also
+// start a longer rule, which is then reported as well when it completes.
+constexpr GrammarRule GRAMMAR_RULES[] = {
+    {UNKNOWN,   0,                      {UNKNOWN}},
+    {ON,        0,                      {ON}},
+    {OFF,       0,                      {OFF}},
+    {ON_OFF,    ms_to_samples(2000),    {ON, OFF}},
+    {OFF_ON,    ms_to_samples(2000),    {OFF, ON}},
+};
+
+// Trie of the rules. Node 0 is the root, which is never a transition target, so 0 in
+// next[] means no transition.
+struct GrammarNode {
+    uint8_t next[N_LABELS] = {};
+    uint8_t command = NO_COMMAND;   // Command completed on reaching this node.
+    int64_t max_gap = 0;            // How long to wait here for the next word.
+};
+
+template<size_t N>
+struct GrammarTable {
+    static_assert(N <= UINT8_MAX, "Node indices are 8-bit");
+
+    GrammarNode nodes[N];
+    bool words[N_LABELS] = {};      // Labels that appear in any rule.
+    size_t size = 1;
+    bool valid = true;              // False on bad words, duplicate rules or too few nodes.
+};
+
+// Builds the transition table at compile time, so that it ends up in flash:
+//   constexpr auto table = build_grammar<8>(GRAMMAR_RULES);
+//   static_assert(table.valid, "");
+template<size_t N, size_t R>
+constexpr GrammarTable<N> build_grammar(const GrammarRule (&rules)[R])
+{
+    GrammarTable<N> table;
+
+    for (size_t r = 0; r < R; ++r) {
+        const GrammarRule &rule = rules[r];
+        size_t node = 0;
+        size_t i = 0;
+
+        for (; i < MAX_RULE_WORDS && rule.words[i] != SILENCE; ++i) {
+            const uint8_t word = rule.words[i];
+
+            if (word >= N_LABELS || table.size == N) {
+                table.valid = false;
+                return table;
+            }
+            if (node && table.nodes[node].max_gap < rule.max_gap)
+                table.nodes[node].max_gap = rule.max_gap;
+            if (!table.nodes[node].next[word])
+                table.nodes[node].next[word] = table.size++;
+
+            table.words[word] = true;
+            node = table.nodes[node].next[word];
+        }
+        if (!i || rule.command >= N_COMMANDS || table.nodes[node].command != NO_COMMAND) {
+            table.valid = false;
+            return table;
+        }
+        table.nodes[node].command = rule.command;
+    }
+    return table;
+}
+
+// Whether VoiceCmd shows a command heard at current_sample, with the last command shown
+// at last_shown. New words within hold of it are dropped. Completed sequences never are:
+// the grammar has consumed their last word, which would otherwise be lost. A sequence
+// spoken within hold is shown as its first word, then the sequence.
+constexpr bool shown_after_hold(const Command &cmd, int64_t current_sample, int64_t last_shown, int64_t hold)
+{
+    return cmd.is_new && (cmd.found_command >= N_LABELS || last_shown < current_sample - hold);
+}
+
+// Matches the recognizer's output against a grammar table, one tick at a time.
+// The state is a node index and a few scalars, each tick is one table lookup.
+class Grammar {
+public:
+    template<size_t N>
+    constexpr Grammar(const GrammarTable<N> &table) : nodes(table.nodes), words(table.words) {}
+
+    // Takes the recognizer's output for a tick, returns a new command when a word
+    // completes a rule. Anything else than a new word of the grammar, SILENCE included,
+    // is returned unchanged. Words that don't continue the current sequence start a
+    // new one.
+    Command process(const Command &cmd, const int64_t current_sample);
+    void reset() { state = 0; }
+private:
+    const GrammarNode *nodes;
+    const bool *words;
+    uint8_t state = 0;
+    uint8_t path_score = 0;         // Lowest word score along the current sequence.
+    int64_t last_word_time = 0;
+};
\ No newline at end of file
@@ -0,0 +1,73 @@
+#include "audio_provider.h"
+#include "features_generator.h"
+#include "op_profiler.h"
+#include "voice_cmd.h"
+
+#pragma once
+
+// Upper bound for the RAM this firmware claims on top of mbed, the BLE stack and the
+// main stack. Set with -D VOICE_CMD_RAM_BUDGET=<bytes>.
+#ifndef VOICE_CMD_RAM_BUDGET
+#define VOICE_CMD_RAM_BUDGET (96 * 1024)
+#endif
+
+// Buffers that live for the whole run and have no better home are placed after the
+// interpreter's part of the tensor arena block. Since the pipeline split nothing is
+// idle while Invoke() runs, so they can't share the interpreter's memory, only the
+// slack it leaves.
+struct ArenaScratch {
+    int8_t feature_store[FEATURE_ELEMENT_COUNT];
+    SpectrogramExchange exchange;
+};
+
+constexpr size_t ARENA_SCRATCH_SIZE = (sizeof(ArenaScratch) + 15) & ~size_t(15);
+
+#ifdef MODEL_ARENA
+// The interpreter's part is measured, the scratch comes on top of it.
+constexpr size_t ARENA_BLOCK_SIZE = TENSOR_ARENA_SIZE + ARENA_SCRATCH_SIZE;
+#else
+// The guessed arena has room to spare, the scratch takes it. If it doesn't,
+// AllocateTensors() fails and on_init() gives up: generate include/model_arena.h.
+constexpr size_t ARENA_BLOCK_SIZE = TENSOR_ARENA_SIZE;
+#endif
+constexpr size_t INTERPRETER_ARENA_SIZE = ARENA_BLOCK_SIZE - ARENA_SCRATCH_SIZE;
+
+static_assert(ARENA_BLOCK_SIZE > ARENA_SCRATCH_SIZE, "Scratch doesn't fit the arena block");
+static_assert(alignof(ArenaScratch) <= 16, "Scratch is placed at a 16-byte boundary");
+
+// Frontend heap. Working buffers are exact, the kissfft config is an estimate, and so
+// are the tables when include/frontend_tables.h hasn't put them in flash.
+constexpr size_t FRONTEND_HEAP_SIZE =
+    2 * FEATURE_SLICE_DURATION_SAMPLES * sizeof(int16_t) +  // Window input and output.
+    (FEATURE_SLICE_SIZE + 1) * sizeof(uint64_t) +           // Filterbank work.
+    FEATURE_SLICE_SIZE * sizeof(uint32_t) +                 // Noise estimate.
+    MAX_AUDIO_SAMPLE_SIZE * sizeof(int16_t) +               // FFT input.
+    (MAX_AUDIO_SAMPLE_SIZE / 2 + 1) * 2 * sizeof(int16_t) + // FFT output.
+    3 * 1024                                                // kissfft config.
+#if !__has_include("frontend_tables.h")
+    + 4 * 1024
+#endif
+    ;
+
+// Everything that is allocated once and kept, largest first.
+constexpr size_t MEMORY_BUDGET[] = {
+    ARENA_BLOCK_SIZE,
+    AUDIO_CAPTURE_SAMPLES * sizeof(int16_t),
+    INFERENCE_THREAD_STACK_SIZE,
+    FRONTEND_HEAP_SIZE,
+    FEATURE_THREAD_STACK_SIZE,
+    sizeof(FeatureExtractor),
+    EVENT_QUEUE_SIZE,
+    sizeof(OpProfiler),
+    sizeof(Recognizer),
+};
+
+constexpr size_t memory_budget_total()
+{
+    size_t total = 0;
+    for (auto size : MEMORY_BUDGET)
+        total += size;
+    return total;
+}
+
+static_assert(memory_budget_total() <= VOICE_CMD_RAM_BUDGET, "Buffers exceed VOICE_CMD_RAM_BUDGET");
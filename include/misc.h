@@ -2,6 +2,14 @@
 
 #pragma once
 
+// The audio clock counts samples since recording started. Milliseconds are only
+// derived from it where needed, and with a power of two samples per millisecond
+// both conversions are shifts.
+static_assert(!(AUDIO_SAMPLES_PER_MS & (AUDIO_SAMPLES_PER_MS - 1)), "Samples per ms must be a power of two");
+
+constexpr int64_t ms_to_samples(int64_t ms)         { return ms * static_cast<int64_t>(AUDIO_SAMPLES_PER_MS); }
+constexpr int64_t samples_to_ms(int64_t samples)    { return samples / static_cast<int64_t>(AUDIO_SAMPLES_PER_MS); }
+
 // std::array implementation to allow return by value and range-based for loop.
 template<class T, size_t N>
 class Array {
@@ -20,14 +28,14 @@ public:
 // Data structure that holds an inference result and the time when it was recorded.
 struct Result {
     Result() = default;
-    Result(int32_t time_, const Array<int8_t, N_LABELS> &scores_) : time(time_), scores(scores_) {}
-    Result(int32_t time_, int8_t *scores_) : time(time_) 
+    Result(int64_t time_, const Array<int8_t, N_LABELS> &scores_) : time(time_), scores(scores_) {}
+    Result(int64_t time_, const int8_t *scores_) : time(time_) 
     {
         for (size_t i = 0; i < N_LABELS; ++i)
             scores[i] = scores_[i];
     }
 
-    int32_t time = 0;
+    int64_t time = 0;   // Audio sample clock.
     Array<int8_t, N_LABELS> scores = {};
 };
 
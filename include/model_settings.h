@@ -8,6 +8,7 @@
 // with 30ms of 16KHz inputs, which means 480 samples, this is the next value.
 constexpr size_t MAX_AUDIO_SAMPLE_SIZE = 512;
 constexpr size_t AUDIO_SAMPLE_FREQUENCY = 16000;
+constexpr size_t AUDIO_SAMPLES_PER_MS = AUDIO_SAMPLE_FREQUENCY / 1000;
 
 // The following values are derived from values used during model training.
 constexpr size_t FEATURE_SLICE_SIZE = 40;
@@ -15,9 +16,25 @@ constexpr size_t FEATURE_SLICE_COUNT = 49;
 constexpr size_t FEATURE_ELEMENT_COUNT = FEATURE_SLICE_SIZE * FEATURE_SLICE_COUNT;
 constexpr size_t FEATURE_SLICE_STRIDE_MS = 20;
 constexpr size_t FEATURE_SLICE_DURATION_MS = 30;
+constexpr size_t FEATURE_SLICE_STRIDE_SAMPLES = FEATURE_SLICE_STRIDE_MS * AUDIO_SAMPLES_PER_MS;
+constexpr size_t FEATURE_SLICE_DURATION_SAMPLES = FEATURE_SLICE_DURATION_MS * AUDIO_SAMPLES_PER_MS;
 
-// The size of this will depend on the model you're using, and may need to be determined by experimentation.
+// Headroom on top of the measured arena, for alignment differences between the host
+// that measured it and the device. Set with -D VOICE_CMD_ARENA_MARGIN=<bytes>.
+#ifndef VOICE_CMD_ARENA_MARGIN
+#define VOICE_CMD_ARENA_MARGIN 512
+#endif
+
+// The arena is sized from include/model_arena.h when it has been generated for the
+// model (see tools/gen_model_arena.cpp), otherwise it is a guess that fits.
+#if __has_include("model_arena.h")
+#include "model_arena.h"
+#define MODEL_ARENA 1
+constexpr size_t TENSOR_ARENA_SIZE = (model_arena::used_bytes + VOICE_CMD_ARENA_MARGIN + 15) & ~size_t(15);
+static_assert(TENSOR_ARENA_SIZE >= model_arena::used_bytes + VOICE_CMD_ARENA_MARGIN, "Arena must cover the model and the margin");
+#else
 constexpr size_t TENSOR_ARENA_SIZE = 30 * 1024;
+#endif
 
 enum : uint8_t {
     SILENCE,
@@ -0,0 +1,37 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <tensorflow/lite/core/api/profiler.h>
+
+#pragma once
+
+// Most nodes the graph may have, later nodes are not profiled.
+constexpr size_t OP_PROFILER_MAX_OPS = 16;
+// Invocations in the rolling window the table is computed over.
+constexpr size_t OP_PROFILER_WINDOW = 16;
+
+// Profiler for the MicroInterpreter, which reports an event around every operator it
+// invokes. Times each node in stage timer ticks, cycles on the device, and keeps the
+// last OP_PROFILER_WINDOW invocations. Events are expected from a single thread,
+// print() may run on another one and then sees a slightly stale window.
+class OpProfiler : public tflite::Profiler {
+public:
+    using Profiler::BeginEvent;
+    using Profiler::EndEvent;
+
+    uint32_t BeginEvent(const char *tag, EventType event_type, int64_t event_metadata1, int64_t event_metadata2) override;
+    void EndEvent(uint32_t event_handle) override;
+
+    // Prints min, mean and max per node over the window, and its share of the total.
+    void print() const;
+    void reset();
+private:
+    struct Op {
+        const char *tag = nullptr;
+        uint32_t start = 0;
+        uint32_t ticks[OP_PROFILER_WINDOW] = {};
+    };
+    Op ops[OP_PROFILER_MAX_OPS];
+    size_t op_count = 0;        // Highest node index seen plus one.
+    uint32_t invocations = 0;
+};
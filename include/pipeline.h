@@ -0,0 +1,57 @@
+#include <tensorflow/lite/micro/micro_interpreter.h>
+
+#include "feature_provider.h"
+#include "grammar.h"
+#include "recognizer.h"
+#include "spectrogram_exchange.h"
+#include "stage_timer.h"
+
+#pragma once
+
+// The recognition pipeline as two stages, each meant for its own thread. The feature
+// stage keeps up with the audio and must not be held up, the inference stage runs the
+// model on the latest spectrogram whenever it gets to it. Nothing here knows about
+// threads, the device runs the stages on mbed threads and the host on std::threads.
+
+// Turns the audio captured so far into slices, and publishes the spectrogram every
+// cadence samples.
+class FeatureStage {
+public:
+    FeatureStage(FeatureProvider &provider_, SpectrogramExchange &exchange_, int64_t cadence_)
+        : provider(provider_), exchange(exchange_), cadence(cadence_)
+    {}
+
+    // Sets published when a spectrogram is handed over. Fails if the frontend does.
+    TfLiteStatus process(bool &published);
+private:
+    FeatureProvider &provider;
+    SpectrogramExchange &exchange;
+    const int64_t cadence;
+    int64_t next_inference_sample = 0;
+};
+
+// Runs the model on the latest published spectrogram, and the recognizer and grammar
+// on its output. Spectrograms published meanwhile are dropped, only the latest counts.
+// Taking longer than deadline_us from publishing to the command counts as an overrun.
+class InferenceStage {
+public:
+    InferenceStage(tflite::MicroInterpreter &interpreter_, SpectrogramExchange &exchange_, Recognizer &recognizer_, Grammar &grammar_, uint32_t deadline_us_)
+        : interpreter(interpreter_), exchange(exchange_), recognizer(recognizer_), grammar(grammar_), deadline_us(deadline_us_)
+    {}
+
+    // Returns false if nothing new was published or on failure, then status tells which.
+    // Otherwise cmd is the grammar's output for the spectrogram ending at sample.
+    bool process(Command &cmd, int64_t &sample, TfLiteStatus &status);
+
+    uint32_t executed() const { return executed_inferences; }
+    uint32_t skipped() const { return skipped_inferences; }
+private:
+    tflite::MicroInterpreter &interpreter;
+    SpectrogramExchange &exchange;
+    Recognizer &recognizer;
+    Grammar &grammar;
+    const uint32_t deadline_us;
+    uint32_t seen = 0;
+    uint32_t executed_inferences = 0;
+    uint32_t skipped_inferences = 0;
+};
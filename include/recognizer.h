@@ -5,25 +5,140 @@
 
 #pragma once
 
+// Results in the averaging window. Times and scores live in separate arrays, the
+// scores of each result in one block of labels, and the sum of every label is kept
+// up to date as results enter and leave, so the average takes a single pass over
+// the labels whatever the window length.
+class ScoreWindow {
+public:
+    // Drops the oldest result if the window is full.
+    void push_back(const int64_t time, const int8_t *scores);
+    // Responsibility to check empty() is on the caller.
+    void pop_front();
+    void clear();
+    Array<int32_t, N_LABELS> average() const;
+
+    bool empty() const          { return !count; }
+    size_t size() const         { return count; }
+    int64_t front_time() const  { return times[head]; }
+    int64_t back_time() const   { return times[(head + count - 1) & mask]; }
+
+    // Fits a second of results at one per slice stride.
+    static constexpr size_t capacity = 64;
+private:
+    static constexpr size_t mask = capacity - 1;
+
+    int64_t times[capacity] = {};
+    Array<int8_t, N_LABELS> scores[capacity];
+    Array<int32_t, N_LABELS> sums;  // Of scores offset by 128, so that they are positive.
+    size_t head = 0;
+    size_t count = 0;
+};
+
+// How the recognizer smooths the model's scores over time before deciding.
+enum class Smoothing : uint8_t {
+    AVERAGE,    // Boxcar average over a window, needs a minimum count of results first.
+    EWMA,       // Exponentially weighted moving average, constant state and no warm-up.
+    HMM,        // Left-to-right keyword HMM, Viterbi decoded over log posterior ratios.
+};
+
+// Tunables of the recognizer, times on the audio sample clock. Scores and thresholds
+// are offset by 128, so 0..255.
+struct RecognizerConfig {
+    Smoothing smoothing;
+    bool early_trigger;                 // Also fire on early_count raw scores in a row above early_threshold.
+    int64_t avg_window_duration;        // AVERAGE: window length.
+    int32_t min_count;                  // AVERAGE: results needed in the window.
+    int64_t ewma_time_constant;         // EWMA: time for a new score to take 63% weight.
+    int32_t hmm_threshold;              // HMM: log2 ratio sum in Q8 to fire, capped at twice that.
+    uint8_t hmm_min_frames;             // HMM: results spent in the keyword state to fire.
+    uint8_t early_threshold;
+    uint8_t early_count;
+    int64_t suppression;                // Time before the same command can fire again.
+    int64_t hold;                       // Time a command stays shown by VoiceCmd.
+    uint8_t thresholds[N_LABELS];       // Smoothed score to fire, per label.
+};
+
+enum : uint8_t {
+    BALANCED,
+    LOW_LATENCY,
+    LOW_FALSE_ACCEPT,
+    N_PROFILES // Don't modify, leave at the end of the enum.
+};
+
+constexpr RecognizerConfig RECOGNIZER_PROFILES[N_PROFILES] = {
+    // BALANCED
+    {Smoothing::AVERAGE, false, ms_to_samples(1000), 3, ms_to_samples(250), 6 << 8, 2, 230, 2, 
+        ms_to_samples(1500), ms_to_samples(1500), {200, 215, 180, 180}},
+    // LOW_LATENCY
+    {Smoothing::EWMA, true, ms_to_samples(500), 2, ms_to_samples(150), 5 << 8, 2, 220, 2, 
+        ms_to_samples(1000), ms_to_samples(1000), {200, 215, 170, 170}},
+    // LOW_FALSE_ACCEPT
+    {Smoothing::AVERAGE, false, ms_to_samples(1000), 4, ms_to_samples(250), 8 << 8, 3, 240, 3, 
+        ms_to_samples(2000), ms_to_samples(1500), {200, 230, 210, 210}},
+};
+
+// Whether the recognizer can run with the config.
+constexpr bool valid_config(const RecognizerConfig &config)
+{
+    return  config.avg_window_duration > 0 &&
+            config.avg_window_duration / FEATURE_SLICE_STRIDE_SAMPLES + 1 <= ScoreWindow::capacity &&
+            config.min_count > 0 &&
+            config.ewma_time_constant > 0 &&
+            config.hmm_threshold > 0 &&
+            config.suppression >= 0 &&
+            config.hold >= 0;
+}
+
+static_assert(valid_config(RECOGNIZER_PROFILES[BALANCED]), "");
+static_assert(valid_config(RECOGNIZER_PROFILES[LOW_LATENCY]), "");
+static_assert(valid_config(RECOGNIZER_PROFILES[LOW_FALSE_ACCEPT]), "");
+
 // Primitive decoding model for results from audio recognition model on a single window of samples.
 class Recognizer {
 public:
+    Recognizer(const RecognizerConfig &config_ = RECOGNIZER_PROFILES[BALANCED]) : cfg(config_) {}
+
+    // Switches the config from the next result on. Smoothing restarts, the suppression
+    // of the last command is kept. Returns false and keeps the current config if invalid.
+    bool set_config(const RecognizerConfig &config_);
+    const RecognizerConfig& config() const { return cfg; }
+
     Command process_results(
         const TfLiteTensor &latest_results, 
-        const int32_t current_time_ms, 
+        const int64_t current_sample, 
+        TfLiteStatus &status);
+    // Same as process_results(), for a tick where the model was skipped because
+    // no voice was detected. Feeds a confident silence result.
+    Command process_silence(
+        const int64_t current_sample, 
+        TfLiteStatus &status);
+    // Same as process_results(), for raw int8 scores, one per label.
+    Command process_scores(
+        const int8_t *scores, 
+        const int64_t current_sample, 
         TfLiteStatus &status);
 private:
-    // Calculate the average score across all the results in the window.
-    Array<int32_t, N_LABELS> calculate_average();
+    Command smooth(const int8_t *scores, const int64_t current_sample);
+    Command smooth_average(const int8_t *scores, const int64_t current_sample);
+    Command smooth_ewma(const int8_t *scores, const int64_t current_sample);
+    Command smooth_hmm(const int8_t *scores, const int64_t current_sample);
+    Command trigger_early(const int8_t *scores, const int64_t current_sample);
+    // Applies the threshold and the suppression of repeated commands.
+    Command decide(uint8_t top_index, int32_t top_score, bool confident, const int64_t current_sample);
     size_t find_highest(const Array<int32_t, N_LABELS> &scores);
 
-    static constexpr int32_t avg_window_duration_ms = 1000;
-    static constexpr int32_t suppression_ms = 1500;
-    static constexpr int32_t min_count = 3;
-    static const uint8_t thresholds[N_LABELS];
+    // Labels from first_keyword on are keywords, the others form the HMM filler model.
+    static constexpr uint8_t first_keyword = ON;
 
-    RingBuf<Result, FEATURE_SLICE_COUNT + 1> prev_results;
+    RecognizerConfig cfg;
+    ScoreWindow prev_results;
+    Array<int32_t, N_LABELS> ewma;          // Scores offset by 128, in Q8.
+    Array<int32_t, N_LABELS> hmm_scores;    // Best path score ending in each keyword state.
+    Array<uint8_t, N_LABELS> hmm_frames;    // Frames spent in each keyword state on that path.
+    Array<uint8_t, N_LABELS> early_runs;    // Consecutive results above early_threshold.
+    bool started = false;
+    int64_t last_sample = 0;
     uint8_t prev_top_idx = SILENCE;
-    int32_t prev_top_time = std::numeric_limits<int32_t>::max(); // FIXME min()
-};
-
+    int64_t prev_top_time = std::numeric_limits<int64_t>::max(); // FIXME min()
+};
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "model_settings.h"
+
+#pragma once
+
+// Hands spectrograms from the feature thread to the inference thread without locks.
+// The writer alternates between two buffers, so it never waits for the reader, and each
+// buffer has a version that is odd while it is written. The reader copies the latest
+// buffer out and retries if the version changed meanwhile, which takes the writer
+// lapping it twice, a couple of strides at least.
+class SpectrogramExchange {
+public:
+    struct Header {
+        int64_t sample = 0; // Audio sample clock position the spectrogram ends at.
+        bool voice = false; // False if the features were skipped for lack of voice.
+        uint32_t ticks = 0; // Stage timer when published.
+    };
+
+    // Writer: returns the buffer to fill with the next spectrogram in time order.
+    int8_t* begin_write()
+    {
+        const size_t i = next();
+
+        versions[i].store(versions[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return slots[i].features;
+    }
+    // Writer: publishes the buffer returned by begin_write().
+    void publish(const Header &header)
+    {
+        const size_t i = next();
+
+        slots[i].header = header;
+        versions[i].store(versions[i].load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        published.store(published.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    // Reader: copies the latest spectrogram to dst unless it was already read, as told
+    // by seen, which is updated. The features are only copied when there is voice.
+    bool read(int8_t *dst, Header &header, uint32_t &seen) const
+    {
+        uint32_t count, version;
+        do {
+            count = published.load(std::memory_order_acquire);
+            if (count == seen)
+                return false;
+
+            const Slot &slot = slots[(count - 1) & 1];
+            version = versions[(count - 1) & 1].load(std::memory_order_acquire);
+            if (version & 1)
+                continue;
+
+            header = slot.header;
+            if (header.voice)
+                memcpy(dst, slot.features, FEATURE_ELEMENT_COUNT);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((version & 1) || version != versions[(count - 1) & 1].load(std::memory_order_relaxed));
+
+        seen = count;
+        return true;
+    }
+private:
+    size_t next() const { return published.load(std::memory_order_relaxed) & 1; }
+
+    struct Slot {
+        Header header;
+        int8_t features[FEATURE_ELEMENT_COUNT];
+    };
+    Slot slots[2];
+    std::atomic<uint32_t> versions[2] = {};
+    std::atomic<uint32_t> published{0};
+};
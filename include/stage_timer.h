@@ -0,0 +1,59 @@
+#include <cstddef>
+#include <cstdint>
+
+#pragma once
+
+// Pipeline stages timed by the deadline monitor.
+enum Stage : uint8_t {
+    STAGE_AUDIO,        // Fetching the captured samples.
+    STAGE_FRONTEND,     // Turning them into slices.
+    STAGE_COPY,         // Spectrogram into the input tensor.
+    STAGE_INVOKE,
+    STAGE_RECOGNIZE,    // Recognizer and grammar.
+    STAGE_RESPOND,
+    STAGE_INFERENCE,    // From publishing a spectrogram to its command, has a deadline.
+    N_STAGES // Don't modify, leave at the end of the enum.
+};
+
+constexpr const char *STAGE_NAMES[N_STAGES] = {
+    "audio",
+    "frontend",
+    "copy",
+    "invoke",
+    "recognize",
+    "respond",
+    "inference",
+};
+
+// Bin i counts durations in [2^i, 2^(i+1)) us. The first bin also counts 0, the last
+// one everything longer, 2^19 us is over half a second.
+constexpr size_t STAGE_HISTOGRAM_BINS = 20;
+
+struct StageStats {
+    uint32_t count;
+    uint32_t overruns;  // Durations above the deadline.
+    uint32_t max_us;
+    uint32_t bins[STAGE_HISTOGRAM_BINS];
+
+    // Upper bound of the bin in which the given percentage of durations is reached,
+    // at most the max.
+    uint32_t percentile_us(uint32_t percent) const;
+};
+
+// Starts the clock: the DWT cycle counter on the device, steady_clock on the host.
+void init_stage_timer();
+
+// Current time in clock ticks, only meaningful as a difference. Wraps around.
+uint32_t stage_ticks();
+uint32_t stage_ticks_to_us(uint32_t ticks);
+
+// Adds the time since start to the stage's histogram and counts an overrun if it
+// is above deadline_us. Returns the current ticks, to start timing the next stage.
+// Each stage must be recorded from a single thread.
+uint32_t record_stage(Stage stage, uint32_t start, uint32_t deadline_us = UINT32_MAX);
+
+// Stats are read while they are recorded, so they may be off by the one duration
+// being recorded, never torn within a field.
+StageStats get_stage_stats(Stage stage);
+void reset_stage_stats();
+void print_stage_stats();
@@ -0,0 +1,46 @@
+#ifdef ARDUINO
+#include <mbed.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+#pragma once
+
+// Wakes up the one thread that waits on it. Raising an already raised signal does
+// nothing, so a waiter that falls behind wakes up once and catches up on everything.
+// On the device this is an event flag, which can be raised from interrupts.
+class ThreadSignal {
+public:
+    void raise()
+    {
+#ifdef ARDUINO
+        flags.set(1);
+#else
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            raised = true;
+        }
+        cv.notify_one();
+#endif
+    }
+    // Blocks until raised, and clears the signal.
+    void wait()
+    {
+#ifdef ARDUINO
+        flags.wait_any(1);
+#else
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return raised; });
+        raised = false;
+#endif
+    }
+private:
+#ifdef ARDUINO
+    rtos::EventFlags flags;
+#else
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool raised = false;
+#endif
+};
@@ -0,0 +1,23 @@
+#include <cstddef>
+#include <cstdint>
+
+#pragma once
+
+// Cheap time-domain voice activity detector, fed block by block straight from the
+// capture path. Tracks the short-term level of each block (mean absolute amplitude)
+// against an adaptive noise floor that follows quiet blocks quickly and loud ones
+// slowly, so that a steady background is learned but speech is not.
+class VoiceActivityDetector {
+public:
+    // Returns true if the block is loud enough above the noise floor to be voice.
+    bool process(const int16_t *samples, size_t count);
+private:
+    static constexpr int floor_bits = 4;            // Fractional bits of noise_floor.
+    static constexpr int fall_shift = 2;            // Noise floor follows quieter blocks fast...
+    static constexpr int rise_shift = 7;            // ...and louder ones slowly.
+    static constexpr uint32_t voice_ratio = 3;      // Level over the floor to count as voice, ~10 dB.
+    static constexpr uint32_t min_voice_level = 40; // Below this everything is silence.
+
+    uint32_t noise_floor = 0;
+    bool initialized = false;
+};
\ No newline at end of file
@@ -5,6 +5,12 @@
 
 #include <tensorflow/lite/micro/micro_interpreter.h>
 
+#include "audio_source_pdm.h"
+#include "grammar.h"
+#include "pipeline.h"
+#include "recognizer.h"
+#include "stage_timer.h"
+#include "thread_signal.h"
 #include "model_settings.h"
 #include "misc.h"
 
@@ -12,8 +18,38 @@
 
 constexpr const char *DEVICE_NAME = "Arduino_33";
 constexpr const char *UUID_SERVICE = "e31e5d86-e4ca-457b-88b5-0b55ed1940cb";
+
+// Command characteristic: one byte, a label index or a sequence command from grammar.h.
+// A word that completes a sequence is notified as the sequence instead of the word:
+// "on" then "off" within 2 s notifies ON, then ON_OFF, but no OFF, even within the
+// profile's hold. Centrals that only know the single words should treat ON_OFF as OFF
+// and OFF_ON as ON. SILENCE is notified as the recognizer reports it.
 constexpr const char *UUID_CHAR = "e31e5d86-e4ca-457b-88b5-0b55ed1940cc";
 
+// The model runs once every this many new slices, 10 slices of 20 ms match the
+// period of the former 200 ms timer. Lower means lower latency for more CPU.
+constexpr size_t INFERENCE_SLICE_CADENCE = 10;
+
+constexpr size_t EVENT_QUEUE_SIZE = 32 * EVENTS_EVENT_SIZE;
+
+// Stacks of the pipeline threads, the frontend needs less than Invoke().
+constexpr size_t FEATURE_THREAD_STACK_SIZE = 4096;
+constexpr size_t INFERENCE_THREAD_STACK_SIZE = 8192;
+
+constexpr const char *UUID_CONFIG_CHAR = "e31e5d86-e4ca-457b-88b5-0b55ed1940cd";
+
+// Recognizer config characteristic: profile index, then a threshold per label that
+// overrides the profile's, 0 to keep the profile's. Reads return what is in use.
+constexpr size_t CONFIG_VALUE_SIZE = 1 + N_LABELS;
+
+constexpr const char *UUID_STATS_CHAR = "e31e5d86-e4ca-457b-88b5-0b55ed1940ce";
+
+// Stage timing characteristic: per stage in Stage order, little-endian u32 count, p50,
+// p99 and max in us, and overruns. Refreshed every STATS_PERIOD.
+constexpr size_t STATS_STAGE_FIELDS = 5;
+constexpr size_t STATS_VALUE_SIZE = N_STAGES * STATS_STAGE_FIELDS * sizeof(uint32_t);
+constexpr auto STATS_PERIOD = std::chrono::milliseconds(500);
+
 void schedule_ble_events(BLE::OnEventsToProcessCallbackContext *context);
 
 // Small custom BLE service to provide voice command characteristic.
@@ -22,18 +58,31 @@ public:
     VoiceCmdService(BLE &ble_);
 
     void update_command(uint8_t cmd_);
+    void update_config(uint8_t profile, const RecognizerConfig &config);
+    void update_stats();
+    GattAttribute::Handle_t config_handle() const { return config_characteristic.getValueHandle(); }
 private:
     BLE &ble;
     uint8_t cmd = SILENCE;
+    uint8_t config_value[CONFIG_VALUE_SIZE] = {};
+    uint8_t stats_value[STATS_VALUE_SIZE] = {};
     ReadOnlyGattCharacteristic<uint8_t> characteristic{
         UUID_CHAR,
         &cmd,
         GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ | 
         GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY
     };
+    ReadWriteArrayGattCharacteristic<uint8_t, CONFIG_VALUE_SIZE> config_characteristic{
+        UUID_CONFIG_CHAR,
+        config_value
+    };
+    ReadOnlyArrayGattCharacteristic<uint8_t, STATS_VALUE_SIZE> stats_characteristic{
+        UUID_STATS_CHAR,
+        stats_value
+    };
 };
 
-class VoiceCmd : ble::Gap::EventHandler {
+class VoiceCmd : ble::Gap::EventHandler, GattServer::EventHandler {
 public:
     VoiceCmd(BLE &ble_) : ble(ble_) {}
 
@@ -43,16 +92,26 @@ private:
     void on_init(BLE::InitializationCompleteCallbackContext *params);
     // Set BLE payload and advertise.
     void start_advertising();
-    // Called every time the results of an audio recognition run are available.
-    void inference();
+    // Called from the audio interrupt every feature stride, wakes up the feature thread.
+    static void audio_stride_ready(void *context);
+    // Feature thread, above the event queue: turns audio into slices as it arrives.
+    void feature_loop();
+    // Inference thread, below the event queue: runs the model and the recognizer on the
+    // latest spectrogram, and posts the outcome to the event queue.
+    void inference_loop();
     // Blink LED based on the recognized command.
-    void respond(int32_t current_time, const Command &cmd);
+    void respond(int64_t current_sample, const Command &cmd);
+    // Publishes the stage stats, and handles serial commands: 's' prints the stats,
+    // 'p' the per-op profile of the model, 'r' resets both.
+    void monitor();
     // Blinking with RGB when awaiting for connection.
     void waiting_blink();
     // Disconnect callback.
     void onDisconnectionComplete(const ble::DisconnectionCompleteEvent&) override;
     // Connect callback.
     void onConnectionComplete(const ble::ConnectionCompleteEvent &event) override;
+    // Recognizer config written by the central.
+    void onDataWritten(const GattWriteCallbackParams &params) override;
     // Print MAC.
     void print_mac_address();
 
@@ -60,10 +119,19 @@ private:
     VoiceCmdService service{ble};
     UUID uuid = UUID_SERVICE;
     int respond_event;
+    uint8_t profile = BALANCED;
+    // Config last written by the central, the recognizer picks it up before its next run.
+    RecognizerConfig config = RECOGNIZER_PROFILES[BALANCED];
+    bool config_pending = false;
+    rtos::Mutex config_mutex;
+    PdmAudioSource audio_source;
 
-    int32_t previous_time;
-    int8_t *model_input_buffer;
-    tflite::MicroInterpreter *interpreter;
+    ThreadSignal audio_signal;
+    ThreadSignal spectrogram_signal;
+    FeatureStage *feature_stage;
+    InferenceStage *inference_stage;
+    rtos::Thread feature_thread{osPriorityAboveNormal, FEATURE_THREAD_STACK_SIZE, nullptr, "features"};
+    rtos::Thread inference_thread{osPriorityBelowNormal, INFERENCE_THREAD_STACK_SIZE, nullptr, "inference"};
 
     uint8_t adv_buffer[ble::LEGACY_ADVERTISING_MAX_SIZE];
     ble::AdvertisingDataBuilder adv_data_builder{adv_buffer};
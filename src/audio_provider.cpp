@@ -1,75 +1,144 @@
 #include "audio_provider.h"
+#include "capture_ring.h"
+#include "voice_activity.h"
 #include "model_settings.h"
 #include "misc.h"
-#include "PDM.h"
 
 namespace {
 
-constexpr size_t capture_buffer_size = DEFAULT_PDM_BUFFER_SIZE * 16;
-constexpr size_t ring_buffer_mask = capture_buffer_size - 1;
-// An internal buffer able to fit 16x our sample size.
-int16_t capture_buffer[capture_buffer_size]; // FIXME + DEFAULT_PDM_BUFFER_SIZE
+constexpr size_t capture_buffer_size = AUDIO_CAPTURE_SAMPLES;
+// An internal ring able to fit 32 audio blocks, written by the audio source.
+CaptureRing<int16_t, capture_buffer_size> capture;
 
-// A buffer that holds our output.
-int16_t output_buffer[MAX_AUDIO_SAMPLE_SIZE];
-// Mark as volatile so we can check in a while loop to see if any samples have arrived yet.
-volatile int32_t latest_audio_timestamp = 0;
+VoiceActivityDetector vad;
+// How many samples have been captured since the last block with voice. Saturates.
+std::atomic<uint32_t> silent_samples{UINT32_MAX};
+
+AudioSource *source = nullptr;
+int16_t *pending_block = nullptr;
+
+static_assert(AUDIO_BLOCK_SAMPLES <= FEATURE_SLICE_STRIDE_SAMPLES, "A block must complete at most one stride");
+
+std::atomic<AudioStrideHandler> stride_handler{nullptr};
+void *stride_context = nullptr;
+// Samples captured since the last completed stride.
+size_t stride_fill = 0;
 
 }
 
-void callback_pdm()
+int16_t* begin_audio_block()
 {
-    // Determine the index, in the history of all samples, of the last sample
-    const int32_t start_sample_offset = latest_audio_timestamp * (AUDIO_SAMPLE_FREQUENCY / 1000);
-    // Determine the index of this sample in our ring buffer
-    const size_t capture_idx = start_sample_offset & ring_buffer_mask;
-    // Read the data to the correct place in our buffer
-    PDM.read(capture_buffer + capture_idx, DEFAULT_PDM_BUFFER_SIZE);
-    // Calculate what timestamp the last audio sample represents.
-    // This is how we let the outside world know that new audio data has arrived.
-    latest_audio_timestamp += (DEFAULT_PDM_BUFFER_SIZE / (AUDIO_SAMPLE_FREQUENCY / 1000));
+    pending_block = capture.prepare(AUDIO_BLOCK_SAMPLES);
+    return pending_block;
+}
+
+void end_audio_block()
+{
+    // Publishing the block is how we let the outside world know that new audio data has arrived.
+    capture.commit(AUDIO_BLOCK_SAMPLES);
+
+    const uint32_t silent = silent_samples.load(std::memory_order_relaxed);
+    if (vad.process(pending_block, AUDIO_BLOCK_SAMPLES))
+        silent_samples.store(0, std::memory_order_relaxed);
+    else if (silent < UINT32_MAX - AUDIO_BLOCK_SAMPLES)
+        silent_samples.store(silent + AUDIO_BLOCK_SAMPLES, std::memory_order_relaxed);
+    else
+        silent_samples.store(UINT32_MAX, std::memory_order_relaxed);
+
+    // Blocks and strides don't line up, some blocks complete a stride, some don't.
+    stride_fill += AUDIO_BLOCK_SAMPLES;
+    if (stride_fill >= FEATURE_SLICE_STRIDE_SAMPLES) {
+        stride_fill %= FEATURE_SLICE_STRIDE_SAMPLES;
+        const auto handler = stride_handler.load(std::memory_order_acquire);
+        if (handler)
+            handler(stride_context);
+    }
 }
 
-TfLiteStatus init_audio_recording()
+void set_audio_stride_handler(AudioStrideHandler handler, void *context)
 {
-    PDM.onReceive(callback_pdm);
-    PDM.setGain(20);
-    // Start listening for audio: MONO @ 16KHz.
-    if (!PDM.begin(1, AUDIO_SAMPLE_FREQUENCY)) 
+    stride_handler.store(nullptr, std::memory_order_release);
+    stride_context = context;
+    stride_handler.store(handler, std::memory_order_release);
+}
+
+TfLiteStatus init_audio_recording(AudioSource &source_)
+{
+    source = &source_;
+
+    if (source->begin() != kTfLiteOk) 
         return kTfLiteError;
     // Block until we have our first audio sample
-    while (!latest_audio_timestamp);
-
+    while (!get_latest_audio_sample()) {
+        if (source->finished())
+            return kTfLiteError;
+    }
     return kTfLiteOk;
 }
 
-TfLiteStatus get_audio_samples(
-    size_t start_ms, 
-    size_t duration_ms,
-    size_t &audio_samples_size, 
-    int16_t **audio_samples)
+TfLiteStatus get_audio_samples_view(
+    int64_t start_sample, 
+    size_t sample_count,
+    AudioSamplesView &view)
 {
-    // Determine the index, in the history of all samples, of the first sample we want.
-    const size_t start_offset = start_ms * (AUDIO_SAMPLE_FREQUENCY / 1000);
-    // Determine how many samples we want in total
-    const size_t duration_sample_count = duration_ms * (AUDIO_SAMPLE_FREQUENCY / 1000);
-
-    for (size_t i = 0; i < duration_sample_count; ++i) {
-        // For each sample, transform its index in the history of all samples into
-        // its index in capture_buffer
-        const size_t capture_index = (start_offset + i) & ring_buffer_mask;
-        // Write the sample to the output buffer
-        output_buffer[i] = capture_buffer[capture_index];
+    const uint32_t start_offset = start_sample;
+
+    if (start_sample < 0)
+        return kTfLiteError;
+    if (!capture.readable(start_offset, sample_count)) {
+        capture.note_overrun();
+        return kTfLiteError;
     }
+    capture.release(start_offset);
 
-    // Set pointers to provide access to the audio
-    audio_samples_size = MAX_AUDIO_SAMPLE_SIZE;
-    *audio_samples = output_buffer;
+    // Split the window where it crosses the end of the ring.
+    const size_t capture_index = start_offset & (capture_buffer_size - 1);
+    const size_t samples_to_end = capture_buffer_size - capture_index;
 
+    view.start = start_sample;
+    view.first = capture.at(start_offset);
+    if (sample_count <= samples_to_end) {
+        view.first_size = sample_count;
+        view.second = nullptr;
+        view.second_size = 0;
+    } else {
+        view.first_size = samples_to_end;
+        view.second = capture.at(0);
+        view.second_size = sample_count - samples_to_end;
+    }
     return kTfLiteOk;
 }
 
-int32_t get_latest_audio_timestamp() 
+bool audio_samples_intact(const AudioSamplesView &view)
+{
+    if (capture.intact(view.start))
+        return true;
+    capture.note_overrun();
+    return false;
+}
+
+void release_audio_samples(int64_t sample)
+{
+    capture.release(sample);
+}
+
+AudioStats get_audio_stats()
+{
+    return {capture.overrun_count(), capture.dropped_block_count()};
+}
+
+uint32_t get_silent_samples()
+{
+    return silent_samples.load(std::memory_order_relaxed);
+}
+
+int64_t get_latest_audio_sample() 
 { 
-    return latest_audio_timestamp; 
+    source->poll();
+    return get_captured_audio_sample(); 
+}
+
+int64_t get_captured_audio_sample()
+{
+    return capture.write_sequence64();
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+#ifndef ARDUINO
+
+#include <cstring>
+
+#include "audio_source_file.h"
+#include "model_settings.h"
+
+namespace {
+
+uint32_t read_le32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24; }
+uint16_t read_le16(const uint8_t *p) { return p[0] | p[1] << 8; }
+
+// Skips bytes without seeking, so that pipes work too.
+bool skip(FILE *file, size_t size)
+{
+    uint8_t buf[64];
+    while (size) {
+        const size_t chunk = size < sizeof(buf) ? size : sizeof(buf);
+        if (fread(buf, 1, chunk, file) != chunk)
+            return false;
+        size -= chunk;
+    }
+    return true;
+}
+
+}
+
+FileAudioSource::~FileAudioSource()
+{
+    if (file && file != stdin)
+        fclose(file);
+}
+
+TfLiteStatus FileAudioSource::begin()
+{
+    if (!file) {
+        printf("No audio file to read\n");
+        return kTfLiteError;
+    }
+    if (format == Format::WAV && parse_wav_header() != kTfLiteOk)
+        return kTfLiteError;
+
+    start_time = std::chrono::steady_clock::now();
+    return kTfLiteOk;
+}
+
+TfLiteStatus FileAudioSource::parse_wav_header()
+{
+    uint8_t riff[12];
+
+    if (fread(riff, 1, sizeof(riff), file) != sizeof(riff) || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) {
+        printf("Not a RIFF/WAVE file\n");
+        return kTfLiteError;
+    }
+    bool has_format = false;
+
+    for (;;) {
+        uint8_t chunk[8];
+
+        if (fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk)) {
+            printf("WAV file has no data chunk\n");
+            return kTfLiteError;
+        }
+        const uint32_t size = read_le32(chunk + 4);
+
+        if (!memcmp(chunk, "fmt ", 4)) {
+            uint8_t fmt[16];
+
+            if (size < sizeof(fmt) || fread(fmt, 1, sizeof(fmt), file) != sizeof(fmt) || !skip(file, size - sizeof(fmt) + (size & 1)))
+                return kTfLiteError;
+
+            const uint16_t audio_format = read_le16(fmt);
+            const uint16_t channels = read_le16(fmt + 2);
+            const uint32_t sample_rate = read_le32(fmt + 4);
+            const uint16_t bits_per_sample = read_le16(fmt + 14);
+
+            if (audio_format != 1 || channels != 1 || sample_rate != AUDIO_SAMPLE_FREQUENCY || bits_per_sample != 16) {
+                printf("WAV must be 16-bit PCM mono @ %d Hz, got format %d, %d channels @ %lu Hz, %d bits\n",
+                    static_cast<int>(AUDIO_SAMPLE_FREQUENCY), audio_format, channels, static_cast<unsigned long>(sample_rate), bits_per_sample);
+                return kTfLiteError;
+            }
+            has_format = true;
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (!has_format) {
+                printf("WAV data chunk before fmt chunk\n");
+                return kTfLiteError;
+            }
+            data_left = size;
+            return kTfLiteOk;
+        } else if (!skip(file, size + (size & 1))) {
+            return kTfLiteError;
+        }
+    }
+}
+
+void FileAudioSource::poll()
+{
+    if (eof)
+        return;
+
+    if (pacing == Pacing::FAST) {
+        due_samples += fast_chunk;
+    } else {
+        // Catch up with the wall clock since begin().
+        const auto elapsed = std::chrono::steady_clock::now() - start_time;
+        due_samples = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() * AUDIO_SAMPLE_FREQUENCY / 1000000;
+    }
+    while (!eof && (blocks_produced + 1) * AUDIO_BLOCK_SAMPLES <= due_samples)
+        produce_block();
+}
+
+void FileAudioSource::produce_block()
+{
+    constexpr size_t block_size = AUDIO_BLOCK_SAMPLES * sizeof(int16_t);
+
+    // Read before claiming the block, the ring invalidates the oldest samples as soon as
+    // a block is begun, and there may be nothing left to put in it.
+    uint8_t samples[block_size];
+    const size_t want = block_size < data_left ? block_size : data_left;
+    const size_t read = fread(samples, 1, want, file);
+
+    data_left -= read;
+    eof = read < block_size;
+    if (!read)
+        return;
+
+    // Pad the last block with silence.
+    int16_t *block = begin_audio_block();
+    memcpy(block, samples, read);
+    memset(reinterpret_cast<uint8_t*>(block) + read, 0, block_size - read);
+    end_audio_block();
+    ++blocks_produced;
+}
+
+#endif
\ No newline at end of file
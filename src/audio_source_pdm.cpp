@@ -0,0 +1,32 @@
+#ifdef ARDUINO
+
+#include "audio_source_pdm.h"
+#include "model_settings.h"
+#include "PDM.h"
+
+// PDM blocks are sized in bytes.
+static_assert(DEFAULT_PDM_BUFFER_SIZE == AUDIO_BLOCK_SAMPLES * sizeof(int16_t), "PDM buffer must hold one audio block");
+
+namespace {
+
+void callback_pdm()
+{
+    // Read the data to the next place in our ring and publish it. Publishing the block
+    // is how we let the outside world know that new audio data has arrived.
+    PDM.read(begin_audio_block(), DEFAULT_PDM_BUFFER_SIZE);
+    end_audio_block();
+}
+
+}
+
+TfLiteStatus PdmAudioSource::begin()
+{
+    PDM.onReceive(callback_pdm);
+    PDM.setGain(20);
+    // Start listening for audio: MONO @ 16KHz.
+    if (!PDM.begin(1, AUDIO_SAMPLE_FREQUENCY)) 
+        return kTfLiteError;
+    return kTfLiteOk;
+}
+
+#endif
\ No newline at end of file
@@ -1,73 +1,113 @@
-#include <mbed.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
 #include "feature_provider.h"
 #include "model_settings.h"
+#include "stage_timer.h"
 
-void FeatureProvider::shift_slices(const size_t slices_to_keep) const
+namespace {
+
+// Quantized value of an empty filterbank channel.
+constexpr int8_t silent_feature = -128;
+// Oldest sample which can still be read safely, one block clear of the producer.
+constexpr int64_t capture_history = AUDIO_CAPTURE_SAMPLES - AUDIO_BLOCK_SAMPLES;
+// Samples which contribute to a full spectrogram.
+constexpr int64_t spectrogram_span = (FEATURE_SLICE_COUNT - 1) * FEATURE_SLICE_STRIDE_SAMPLES + FEATURE_SLICE_DURATION_SAMPLES;
+
+}
+
+void FeatureProvider::copy_to(int8_t *dst) const
 {
-    const size_t slices_to_drop = FEATURE_SLICE_COUNT - slices_to_keep;
+    // Oldest slices first: from the head to the end of the store, then the wrapped part.
+    const size_t head_offset = head * FEATURE_SLICE_SIZE;
 
-    for (size_t dst_slice = 0; dst_slice < slices_to_keep; ++dst_slice) {
+    memcpy(dst, &feature_data[head_offset], FEATURE_ELEMENT_COUNT - head_offset);
+    memcpy(dst + FEATURE_ELEMENT_COUNT - head_offset, &feature_data[0], head_offset);
+}
 
-        int8_t *dst_slice_data = &feature_data[dst_slice * FEATURE_SLICE_SIZE];
-        const int src_slice = dst_slice + slices_to_drop;
-        const int8_t *src_slice_data = &feature_data[src_slice * FEATURE_SLICE_SIZE];
+void FeatureProvider::push_silent_slices(size_t count)
+{
+    if (count > FEATURE_SLICE_COUNT)
+        count = FEATURE_SLICE_COUNT;
 
-        for (size_t i = 0; i < FEATURE_SLICE_SIZE; ++i)
-            dst_slice_data[i] = src_slice_data[i];
+    for (size_t i = 0; i < count; ++i) {
+        memset(&feature_data[head * FEATURE_SLICE_SIZE], silent_feature, FEATURE_SLICE_SIZE);
+        if (++head == FEATURE_SLICE_COUNT)
+            head = 0;
     }
 }
 
-int FeatureProvider::populate_feature_data(int32_t last_time_in_ms, int32_t time_in_ms) const
+int FeatureProvider::stream_samples(const int16_t *samples, size_t count)
 {
-    // 1) Calculate how many time steps we need.
-    const int last_step = last_time_in_ms / FEATURE_SLICE_STRIDE_MS;
-    const int current_step = time_in_ms / FEATURE_SLICE_STRIDE_MS;
-    size_t slices_needed = current_step - last_step;
-
-    if (!last_time_in_ms || slices_needed > FEATURE_SLICE_COUNT)
-        slices_needed = FEATURE_SLICE_COUNT;
-
-    // 2) Determine how many slices to keep and then shift appropriately.
-    const size_t slices_to_keep = FEATURE_SLICE_COUNT - slices_needed;
-    
-    if (slices_to_keep > 0) 
-        shift_slices(slices_to_keep);
-
-    // 3) 
-    if (slices_needed > 0) {
-        
-        for (size_t new_slice = slices_to_keep; new_slice < FEATURE_SLICE_COUNT; ++new_slice) {
-
-            const int new_step = (current_step - FEATURE_SLICE_COUNT + 1) + new_slice;
-            const int32_t slice_start_ms = new_step * FEATURE_SLICE_STRIDE_MS;
-            int16_t *audio_samples = nullptr;
-            size_t audio_samples_size = 0;
-
-            get_audio_samples(
-                slice_start_ms,
-                FEATURE_SLICE_DURATION_MS, 
-                audio_samples_size,
-                &audio_samples);
-
-            if (audio_samples_size < MAX_AUDIO_SAMPLE_SIZE) {
-                printf("Audio data size %d too small, want %d \n", audio_samples_size, MAX_AUDIO_SAMPLE_SIZE);
-                return -1;
-            }
-
-            int8_t *new_slice_data = &feature_data[new_slice * FEATURE_SLICE_SIZE];
-            size_t num_samples_read;
-
-            auto generate_status = generate_micro_features(
-                audio_samples, 
-                audio_samples_size,
-                FEATURE_SLICE_SIZE,
-                new_slice_data,
-                &num_samples_read);
-
-            if (generate_status != kTfLiteOk) 
-                return -1;
+    int new_slices = 0;
+
+    while (count) {
+        size_t num_slices, num_samples_read;
+
+        // Slices are written straight into the store, one at a time at the head.
+        if (stream_micro_features(samples, count, &feature_data[head * FEATURE_SLICE_SIZE], 1, &num_slices, &num_samples_read) != kTfLiteOk)
+            return -1;
+
+        samples += num_samples_read;
+        count -= num_samples_read;
+        if (num_slices) {
+            if (++head == FEATURE_SLICE_COUNT)
+                head = 0;
+            ++new_slices;
         }
     }
-    return slices_needed;
+    return new_slices;
+}
+
+int FeatureProvider::populate_feature_data(int64_t sample)
+{
+    size_t new_slices = 0;
+
+    // 1) If we fell behind further than the spectrogram span or the capture history, the
+    // skipped audio is lost. Account for it with silent slices and restart the frontend
+    // window at the oldest sample worth reading.
+    int64_t oldest = std::max(sample - spectrogram_span, sample - capture_history);
+
+    if (oldest < 0)
+        oldest = 0;
+
+    if (!started || next_sample < oldest) {
+        new_slices = started ? (oldest - next_sample) / FEATURE_SLICE_STRIDE_SAMPLES : FEATURE_SLICE_COUNT;
+        if (new_slices > FEATURE_SLICE_COUNT)
+            new_slices = FEATURE_SLICE_COUNT;
+        push_silent_slices(new_slices);
+        restart_micro_features_window();
+        next_sample = oldest;
+        started = true;
+    }
+    if (sample <= next_sample)
+        return new_slices;
+
+    // 2) Stream the new samples through the frontend in place, in at most two spans.
+    AudioSamplesView view;
+    uint32_t ticks = stage_ticks();
+
+    if (get_audio_samples_view(next_sample, sample - next_sample, view) != kTfLiteOk) {
+        printf("Audio samples [%ld, %ld) unavailable\n", static_cast<long>(next_sample), static_cast<long>(sample));
+        return -1;
+    }
+    ticks = record_stage(STAGE_AUDIO, ticks);
+
+    const int first_slices = stream_samples(view.first, view.first_size);
+    const int second_slices = first_slices < 0 ? -1 : stream_samples(view.second, view.second_size);
+
+    if (second_slices < 0)
+        return -1;
+    next_sample = sample;
+
+    // 3) The producer caught up with us while we were reading, the new slices are garbage.
+    const size_t streamed_slices = std::min<size_t>(first_slices + second_slices, FEATURE_SLICE_COUNT);
+
+    if (!audio_samples_intact(view)) {
+        head = (head + FEATURE_SLICE_COUNT - streamed_slices) % FEATURE_SLICE_COUNT;
+        push_silent_slices(streamed_slices);
+    }
+    record_stage(STAGE_FRONTEND, ticks);
+    return std::min<size_t>(new_slices + streamed_slices, FEATURE_SLICE_COUNT);
 }
\ No newline at end of file
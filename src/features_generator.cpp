@@ -15,12 +15,14 @@ limitations under the License.
 
 #include <cmath>
 #include <cstring>
-#include <mbed.h>
+#include <cstdio>
 
 #include <tensorflow/lite/experimental/microfrontend/lib/frontend.h>
-#include <tensorflow/lite/experimental/microfrontend/lib/frontend_util.h>
 
 #include "features_generator.h"
+#include "features_quantizer.h"
+#include "frontend_config.h"
+#include "frontend_fft.h"
 #include "model_settings.h"
 
 // Configure FFT to output 16 bit fixed point.
@@ -28,85 +30,219 @@ limitations under the License.
 
 namespace {
 
-FrontendState g_micro_features_state;
-bool g_is_first_time = true;
+// Instance behind the global functions.
+FeatureExtractor g_default_extractor;
+
+// Snapshot header: magic, version, then what the frontend config must match.
+constexpr uint8_t snapshot_magic[4] = {'V', 'C', 'F', 'S'};
+constexpr uint16_t snapshot_version = 1;
+constexpr uint8_t snapshot_first_time = 1;
+
+void put_u16(uint8_t *dst, uint16_t val)
+{
+    dst[0] = val;
+    dst[1] = val >> 8;
+}
+
+void put_u32(uint8_t *dst, uint32_t val)
+{
+    put_u16(dst, val);
+    put_u16(dst + 2, val >> 16);
+}
+
+uint16_t get_u16(const uint8_t *src)
+{
+    return src[0] | src[1] << 8;
+}
+
+uint32_t get_u32(const uint8_t *src)
+{
+    return get_u16(src) | static_cast<uint32_t>(get_u16(src + 2)) << 16;
+}
 
 }  // namespace
 
-TfLiteStatus init_micro_features() 
+FeatureExtractor::~FeatureExtractor()
+{
+    if (initialized)
+        free_frontend_state(&state);
+}
+
+TfLiteStatus FeatureExtractor::init() 
 {
-    FrontendConfig config;
-    config.window.size_ms = FEATURE_SLICE_COUNT;
-    config.window.step_size_ms = FEATURE_SLICE_STRIDE_MS;
-    config.noise_reduction.smoothing_bits = 10;
-    config.filterbank.num_channels = FEATURE_SLICE_SIZE;
-    config.filterbank.lower_band_limit = 125.0;
-    config.filterbank.upper_band_limit = 7500.0;
-    config.noise_reduction.smoothing_bits = 10;
-    config.noise_reduction.even_smoothing = 0.025;
-    config.noise_reduction.odd_smoothing = 0.06;
-    config.noise_reduction.min_signal_remaining = 0.05;
-    config.pcan_gain_control.enable_pcan = 1;
-    config.pcan_gain_control.strength = 0.95;
-    config.pcan_gain_control.offset = 80.0;
-    config.pcan_gain_control.gain_bits = 21;
-    config.log_scale.enable_log = 1;
-    config.log_scale.scale_shift = 6;
-    if (!FrontendPopulateState(&config, &g_micro_features_state, AUDIO_SAMPLE_FREQUENCY)) {
-        printf("FrontendPopulateState() failed\r\n");
+    if (initialized) {
+        free_frontend_state(&state);
+        initialized = false;
+    }
+    const bool populated = populate_frontend_state(&state);
+    initialized = true;
+    if (!populated) {
+        printf("populate_frontend_state() failed\r\n");
         return kTfLiteError;
     }
-    g_is_first_time = true;
+    if (init_frontend_fft(fft, state) != kTfLiteOk) {
+        printf("init_frontend_fft() failed\r\n");
+        return kTfLiteError;
+    }
+    is_first_time = true;
     return kTfLiteOk;
 }
 
-// This is not exposed in any header, and is only used for testing, to ensure
-// that the state is correctly set up before generating results.
-void SetMicroFeaturesNoiseEstimates(const uint32_t *estimate_presets) 
+void FeatureExtractor::set_noise_estimates(const uint32_t *estimate_presets) 
 {
-    for (int i = 0; i < g_micro_features_state.filterbank.num_channels; ++i) {
-        g_micro_features_state.noise_reduction.estimate[i] = estimate_presets[i];
+    for (int i = 0; i < state.filterbank.num_channels; ++i) {
+        state.noise_reduction.estimate[i] = estimate_presets[i];
     }
 }
 
-TfLiteStatus generate_micro_features(
+TfLiteStatus FeatureExtractor::generate(
     const int16_t *input, int input_size,
     int output_size, int8_t *output,
     size_t *num_samples_read) 
 {
     const int16_t *frontend_input;
-    if (g_is_first_time) {
+    if (is_first_time) {
         frontend_input = input;
-        g_is_first_time = false;
+        is_first_time = false;
     } else {
         frontend_input = input + 160;
     }
-    FrontendOutput frontend_output = FrontendProcessSamples(
-        &g_micro_features_state, frontend_input, input_size, num_samples_read);
-
-    for (size_t i = 0; i < frontend_output.size; ++i) {
-        // These scaling values are derived from those used in input_data.py in the
-        // training pipeline.
-        // The feature pipeline outputs 16-bit signed integers in roughly a 0 to 670
-        // range. In training, these are then arbitrarily divided by 25.6 to get
-        // float values in the rough range of 0.0 to 26.0. This scaling is performed
-        // for historical reasons, to match up with the output of other feature
-        // generators.
-        // The process is then further complicated when we quantize the model. This
-        // means we have to scale the 0.0 to 26.0 real values to the -128 to 127
-        // signed integer numbers.
-        // All this means that to get matching values from our integer feature
-        // output into the tensor input, we have to perform:
-        // input = (((feature / 25.6) / 26.0) * 256) - 128
-        // To simplify this and perform it in 32-bit integer math, we rearrange to:
-        // input = (feature * 256) / (25.6 * 26.0) - 128
-        constexpr int32_t value_scale = 256;
-        constexpr int32_t value_div = static_cast<int32_t>((25.6f * 26.0f) + 0.5f);
-        int32_t value = ((frontend_output.values[i] * value_scale) + (value_div / 2)) / value_div;
-        value -= 128;
-        if (value < -128) value = -128;
-        if (value > 127) value = 127;
-        output[i] = value;
+    FrontendOutput frontend_output = frontend_process_samples(
+        fft, &state, frontend_input, input_size, num_samples_read);
+
+    quantize_features(frontend_output.values, frontend_output.size, output);
+    return kTfLiteOk;
+}
+
+TfLiteStatus FeatureExtractor::stream(
+    const int16_t *input, size_t input_size,
+    int8_t *output, size_t max_slices,
+    size_t *num_slices, size_t *num_samples_read)
+{
+    *num_slices = 0;
+    *num_samples_read = 0;
+
+    while (input_size && *num_slices < max_slices) {
+        size_t samples_read = 0;
+        FrontendOutput frontend_output = frontend_process_samples(
+            fft, &state, input, input_size, &samples_read);
+
+        input += samples_read;
+        input_size -= samples_read;
+        *num_samples_read += samples_read;
+
+        if (frontend_output.values) {
+            if (frontend_output.size != FEATURE_SLICE_SIZE)
+                return kTfLiteError;
+            quantize_features(frontend_output.values, frontend_output.size, output + *num_slices * FEATURE_SLICE_SIZE);
+            ++*num_slices;
+        }
     }
     return kTfLiteOk;
 }
+
+void FeatureExtractor::restart_window()
+{
+    state.window.input_used = 0;
+}
+
+size_t FeatureExtractor::snapshot(uint8_t *data, size_t size) const
+{
+    const size_t num_channels = state.filterbank.num_channels;
+    const size_t input_used = state.window.input_used;
+    const size_t total = FEATURE_SNAPSHOT_HEADER_SIZE + num_channels * sizeof(uint32_t) + input_used * sizeof(int16_t);
+
+    if (!initialized || size < total)
+        return 0;
+
+    memcpy(data, snapshot_magic, sizeof(snapshot_magic));
+    put_u16(data + 4, snapshot_version);
+    put_u16(data + 6, num_channels);
+    put_u16(data + 8, state.window.size);
+    put_u16(data + 10, state.window.step);
+    put_u16(data + 12, input_used);
+    data[14] = is_first_time ? snapshot_first_time : 0;
+    data[15] = 0;
+    data += FEATURE_SNAPSHOT_HEADER_SIZE;
+
+    for (size_t i = 0; i < num_channels; ++i, data += sizeof(uint32_t))
+        put_u32(data, state.noise_reduction.estimate[i]);
+    // Only the part of the window filled so far, the rest is overwritten before use.
+    for (size_t i = 0; i < input_used; ++i, data += sizeof(int16_t))
+        put_u16(data, state.window.input[i]);
+
+    return total;
+}
+
+TfLiteStatus FeatureExtractor::restore(const uint8_t *data, size_t size)
+{
+    if (!initialized || size < FEATURE_SNAPSHOT_HEADER_SIZE)
+        return kTfLiteError;
+
+    const size_t num_channels = get_u16(data + 6);
+    const size_t input_used = get_u16(data + 12);
+
+    if (memcmp(data, snapshot_magic, sizeof(snapshot_magic)) ||
+        get_u16(data + 4) != snapshot_version ||
+        num_channels != static_cast<size_t>(state.filterbank.num_channels) ||
+        get_u16(data + 8) != state.window.size ||
+        get_u16(data + 10) != state.window.step ||
+        input_used > state.window.size ||
+        size < FEATURE_SNAPSHOT_HEADER_SIZE + num_channels * sizeof(uint32_t) + input_used * sizeof(int16_t))
+        return kTfLiteError;
+
+    is_first_time = data[14] & snapshot_first_time;
+    data += FEATURE_SNAPSHOT_HEADER_SIZE;
+
+    for (size_t i = 0; i < num_channels; ++i, data += sizeof(uint32_t))
+        state.noise_reduction.estimate[i] = get_u32(data);
+    for (size_t i = 0; i < input_used; ++i, data += sizeof(int16_t))
+        state.window.input[i] = get_u16(data);
+    state.window.input_used = input_used;
+
+    return kTfLiteOk;
+}
+
+TfLiteStatus init_micro_features() 
+{
+    return g_default_extractor.init();
+}
+
+// This is not exposed in any header, and is only used for testing, to ensure
+// that the state is correctly set up before generating results.
+void SetMicroFeaturesNoiseEstimates(const uint32_t *estimate_presets) 
+{
+    g_default_extractor.set_noise_estimates(estimate_presets);
+}
+
+TfLiteStatus generate_micro_features(
+    const int16_t *input, int input_size,
+    int output_size, int8_t *output,
+    size_t *num_samples_read) 
+{
+    return g_default_extractor.generate(input, input_size, output_size, output, num_samples_read);
+}
+
+TfLiteStatus stream_micro_features(
+    const int16_t *input, size_t input_size,
+    int8_t *output, size_t max_slices,
+    size_t *num_slices, size_t *num_samples_read)
+{
+    return g_default_extractor.stream(input, input_size, output, max_slices, num_slices, num_samples_read);
+}
+
+void restart_micro_features_window()
+{
+    g_default_extractor.restart_window();
+}
+
+
+size_t snapshot_micro_features(uint8_t *data, size_t size)
+{
+    return g_default_extractor.snapshot(data, size);
+}
+
+TfLiteStatus restore_micro_features(const uint8_t *data, size_t size)
+{
+    return g_default_extractor.restore(data, size);
+}
\ No newline at end of file
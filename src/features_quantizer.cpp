@@ -0,0 +1,67 @@
+#include "features_quantizer.h"
+
+#if defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+using namespace features_quantizer;
+
+void quantize_features(const uint16_t *features, size_t count, int8_t *output)
+{
+    size_t i = 0;
+
+#if defined(__ARM_FEATURE_DSP)
+    // Cortex-M4: pack (feature, 1) against (multiplier, rounding) so that a single
+    // SMUAD yields feature * multiplier + rounding, then saturate with USAT/SSAT
+    // (__USAT/__SSAT in CMSIS terms).
+    constexpr uint32_t constants = static_cast<uint32_t>(rounding) << 16 | multiplier;
+
+    for (; i < count; ++i) {
+        const uint32_t feature = __usat(features[i], 10);
+        const int32_t value = __smuad(feature | 1 << 16, constants);
+        output[i] = __ssat((value >> shift) - 128, 8);
+    }
+#elif defined(__SSE2__)
+    // Eight features per iteration: clamp with an unsigned saturating subtract,
+    // interleave with ones and pmaddwd against (multiplier, rounding) pairs.
+    const __m128i limit = _mm_set1_epi16(max_input);
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i constants = _mm_set1_epi32(rounding << 16 | multiplier);
+    const __m128i offset = _mm_set1_epi32(128);
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(features + i));
+        x = _mm_sub_epi16(x, _mm_subs_epu16(x, limit));
+
+        __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(x, ones), constants);
+        __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(x, ones), constants);
+        lo = _mm_sub_epi32(_mm_srai_epi32(lo, shift), offset);
+        hi = _mm_sub_epi32(_mm_srai_epi32(hi, shift), offset);
+
+        // Both packs saturate, the second one to int8.
+        const __m128i packed = _mm_packs_epi16(_mm_packs_epi32(lo, hi), _mm_setzero_si128());
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), packed);
+    }
+#elif defined(__ARM_NEON)
+    // Eight features per iteration: widening multiply-accumulate onto the rounding
+    // constant, narrowing shift, then a saturating narrow to int8.
+    const uint16x8_t limit = vdupq_n_u16(max_input);
+    const uint16x4_t factor = vdup_n_u16(multiplier);
+    const uint32x4_t bias = vdupq_n_u32(rounding);
+    const int16x8_t offset = vdupq_n_s16(128);
+
+    for (; i + 8 <= count; i += 8) {
+        const uint16x8_t x = vminq_u16(vld1q_u16(features + i), limit);
+        const uint32x4_t lo = vmlal_u16(bias, vget_low_u16(x), factor);
+        const uint32x4_t hi = vmlal_u16(bias, vget_high_u16(x), factor);
+        const uint16x8_t value = vcombine_u16(vshrn_n_u32(lo, shift), vshrn_n_u32(hi, shift));
+        vst1_s8(output + i, vqmovn_s16(vsubq_s16(vreinterpretq_s16_u16(value), offset)));
+    }
+#endif
+    for (; i < count; ++i)
+        output[i] = quantize_scalar(features[i]);
+}
\ No newline at end of file
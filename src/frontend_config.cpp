@@ -0,0 +1,91 @@
+#include <cstdlib>
+
+#include "frontend_config.h"
+
+#if __has_include("frontend_tables.h")
+#include <tensorflow/lite/experimental/microfrontend/lib/fft_util.h>
+#include "frontend_tables.h"
+#define FRONTEND_TABLES 1
+static_assert(frontend_tables::params == FRONTEND_PARAMS, "frontend_tables.h is stale, regenerate it");
+#endif
+
+#ifdef FRONTEND_TABLES
+
+bool populate_frontend_state(FrontendState *state)
+{
+    using namespace frontend_tables;
+
+    *state = {};
+
+    // The library never writes through these, the casts only satisfy its C structs.
+    state->window.size = window_size;
+    state->window.step = window_step;
+    state->window.coefficients = const_cast<int16_t*>(window_coefficients);
+    state->window.input = static_cast<int16_t*>(malloc(window_size * sizeof(int16_t)));
+    state->window.output = static_cast<int16_t*>(malloc(window_size * sizeof(int16_t)));
+
+    state->filterbank.num_channels = num_channels;
+    state->filterbank.start_index = filterbank_start_index;
+    state->filterbank.end_index = filterbank_end_index;
+    state->filterbank.channel_frequency_starts = const_cast<int16_t*>(channel_frequency_starts);
+    state->filterbank.channel_weight_starts = const_cast<int16_t*>(channel_weight_starts);
+    state->filterbank.channel_widths = const_cast<int16_t*>(channel_widths);
+    state->filterbank.weights = const_cast<int16_t*>(filterbank_weights);
+    state->filterbank.unweights = const_cast<int16_t*>(filterbank_unweights);
+    state->filterbank.work = static_cast<uint64_t*>(malloc((num_channels + 1) * sizeof(uint64_t)));
+
+    state->noise_reduction.smoothing_bits = noise_smoothing_bits;
+    state->noise_reduction.even_smoothing = noise_even_smoothing;
+    state->noise_reduction.odd_smoothing = noise_odd_smoothing;
+    state->noise_reduction.min_signal_remaining = noise_min_signal_remaining;
+    state->noise_reduction.num_channels = num_channels;
+    state->noise_reduction.estimate = static_cast<uint32_t*>(calloc(num_channels, sizeof(uint32_t)));
+
+    state->pcan_gain_control.enable_pcan = pcan_enable;
+    state->pcan_gain_control.noise_estimate = state->noise_reduction.estimate;
+    state->pcan_gain_control.num_channels = num_channels;
+    state->pcan_gain_control.gain_lut = const_cast<int16_t*>(pcan_gain_lut);
+    state->pcan_gain_control.snr_shift = pcan_snr_shift;
+
+    state->log_scale.enable_log = log_enable;
+    state->log_scale.scale_shift = log_scale_shift;
+
+    if (!state->window.input ||
+        !state->window.output ||
+        !state->filterbank.work ||
+        !state->noise_reduction.estimate)
+        return false;
+
+    // The kissfft config points into itself, so it is still set up at runtime.
+    if (!FftPopulateState(&state->fft, window_size))
+        return false;
+
+    FrontendReset(state);
+    return true;
+}
+
+void free_frontend_state(FrontendState *state)
+{
+    free(state->window.input);
+    free(state->window.output);
+    FftFreeStateContents(&state->fft);
+    free(state->filterbank.work);
+    free(state->noise_reduction.estimate);
+    *state = {};
+}
+
+#else
+
+bool populate_frontend_state(FrontendState *state)
+{
+    const FrontendConfig config = make_frontend_config();
+    return FrontendPopulateState(&config, state, FRONTEND_PARAMS.sample_rate);
+}
+
+void free_frontend_state(FrontendState *state)
+{
+    FrontendFreeStateContents(state);
+    *state = {};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "frontend_fft.h"
+
+#if defined(VOICE_CMD_FFT_CMSIS)
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <tensorflow/lite/experimental/microfrontend/lib/bits.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/filterbank.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/log_scale.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/noise_reduction.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/pcan_gain_control.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/window.h>
+
+namespace {
+
+constexpr size_t fft_size = 512;
+
+static_assert(fft_size <= MAX_AUDIO_SAMPLE_SIZE, "FrontendFft::output is too small");
+
+// Scaling check: a cosine of this amplitude at this bin has N * amplitude / 2 there in
+// the DFT, which kissfft scales by 1/N.
+constexpr size_t check_bin = 16;
+constexpr int16_t check_amplitude = 8192;
+constexpr int32_t check_expected = check_amplitude / 2;
+constexpr int32_t check_tolerance = check_expected / 16;
+
+// Transforms state->input, which must be staged, into state->output.
+void fft_transform(FrontendFft &fft, FftState *state)
+{
+    arm_rfft_q15(&fft.rfft, state->input, fft.output);
+
+    // For 512 points arm_rfft_q15() outputs 9.7, i.e. the DFT scaled by 1/256,
+    // where kissfft scales by 1/512. init_frontend_fft() checks this.
+    for (size_t i = 0; i <= state->fft_size / 2; ++i) {
+        state->output[i].real = fft.output[2 * i] >> 1;
+        state->output[i].imag = fft.output[2 * i + 1] >> 1;
+    }
+}
+
+void fft_compute(FrontendFft &fft, FftState *state, const int16_t *input, int input_scale_shift)
+{
+    // Same input staging as FftCompute(): scale up and zero pad.
+    size_t i = 0;
+    for (; i < state->input_size; ++i)
+        state->input[i] = input[i] << input_scale_shift;
+    for (; i < state->fft_size; ++i)
+        state->input[i] = 0;
+
+    fft_transform(fft, state);
+}
+
+}
+
+TfLiteStatus init_frontend_fft(FrontendFft &fft, FrontendState &state)
+{
+    if (state.fft.fft_size != fft_size)
+        return kTfLiteError;
+    if (arm_rfft_init_q15(&fft.rfft, fft_size, 0, 1) != ARM_MATH_SUCCESS)
+        return kTfLiteError;
+
+    // The rest of the frontend and the model rely on kissfft's scaling, a library
+    // that scales differently would shift every feature.
+    for (size_t i = 0; i < fft_size; ++i)
+        state.fft.input[i] = lround(check_amplitude * cos(2 * M_PI * check_bin * i / fft_size));
+    fft_transform(fft, &state.fft);
+
+    const complex_int16_t bin = state.fft.output[check_bin];
+    if (abs(bin.real - check_expected) > check_tolerance || abs(bin.imag) > check_tolerance) {
+        printf("arm_rfft_q15() scaling doesn't match kissfft: %d%+di at bin %u, expected %ld\r\n",
+            bin.real, bin.imag, static_cast<unsigned>(check_bin), static_cast<long>(check_expected));
+        return kTfLiteError;
+    }
+    return kTfLiteOk;
+}
+
+FrontendOutput frontend_process_samples(
+    FrontendFft &fft,
+    FrontendState *state, 
+    const int16_t *samples, 
+    size_t num_samples, 
+    size_t *num_samples_read)
+{
+    // Mirrors FrontendProcessSamples() with the FFT swapped out.
+    FrontendOutput output;
+    output.values = nullptr;
+    output.size = 0;
+
+    // Try to apply the window - if it fails, return and wait for more data.
+    if (!WindowProcessSamples(&state->window, samples, num_samples, num_samples_read))
+        return output;
+
+    // Apply the FFT to the window's output (and scale it so that the fixed point
+    // FFT can have as much resolution as possible).
+    const int input_shift = 15 - MostSignificantBit32(state->window.max_abs_output_value);
+    fft_compute(fft, &state->fft, state->window.output, input_shift);
+
+    // We can re-use the fft's output buffer to hold the energy.
+    int32_t *energy = reinterpret_cast<int32_t*>(state->fft.output);
+
+    FilterbankConvertFftComplexToEnergy(&state->filterbank, state->fft.output, energy);
+    FilterbankAccumulateChannels(&state->filterbank, energy);
+    uint32_t *scaled_filterbank = FilterbankSqrt(&state->filterbank, input_shift);
+
+    NoiseReductionApply(&state->noise_reduction, scaled_filterbank);
+
+    if (state->pcan_gain_control.enable_pcan)
+        PcanGainControlApply(&state->pcan_gain_control, scaled_filterbank);
+
+    // Apply the log and scale.
+    const int correction_bits = MostSignificantBit32(state->fft.fft_size) - 1 - (kFilterbankBits / 2);
+
+    output.size = state->filterbank.num_channels;
+    output.values = LogScaleApply(&state->log_scale, scaled_filterbank, state->filterbank.num_channels, correction_bits);
+    return output;
+}
+
+#else
+
+TfLiteStatus init_frontend_fft(FrontendFft&, FrontendState&)
+{
+    return kTfLiteOk;
+}
+
+FrontendOutput frontend_process_samples(
+    FrontendFft&,
+    FrontendState *state, 
+    const int16_t *samples, 
+    size_t num_samples, 
+    size_t *num_samples_read)
+{
+    return FrontendProcessSamples(state, samples, num_samples, num_samples_read);
+}
+
+#endif
\ No newline at end of file
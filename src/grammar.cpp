@@ -0,0 +1,37 @@
+#include "grammar.h"
+
+Command Grammar::process(const Command &cmd, const int64_t current_sample)
+{
+    // Waited too long for the next word, start over.
+    if (state && current_sample - last_word_time > nodes[state].max_gap)
+        state = 0;
+
+    // Repeats, silence and words outside the grammar are none of its business.
+    if (!cmd.is_new || cmd.found_command >= N_LABELS || !words[cmd.found_command])
+        return cmd;
+
+    uint8_t next = state ? nodes[state].next[cmd.found_command] : 0;
+
+    if (next) {
+        if (cmd.score < path_score)
+            path_score = cmd.score;
+    } else {
+        next = nodes[0].next[cmd.found_command];
+        path_score = cmd.score;
+    }
+    last_word_time = current_sample;
+    state = next;
+
+    const uint8_t command = nodes[state].command;
+    bool leaf = true;
+
+    for (auto it : nodes[state].next)
+        leaf &= !it;
+    // Nothing can follow a leaf, return to the root right away.
+    if (leaf)
+        state = 0;
+    if (command == NO_COMMAND)
+        return Command();
+
+    return {command, path_score, true};
+}
\ No newline at end of file
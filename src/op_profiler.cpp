@@ -0,0 +1,88 @@
+#include <cstdio>
+
+#include "op_profiler.h"
+#include "stage_timer.h"
+
+namespace {
+
+constexpr uint32_t no_event = UINT32_MAX;
+
+}
+
+uint32_t OpProfiler::BeginEvent(const char *tag, EventType event_type, int64_t event_metadata1, int64_t)
+{
+    // The interpreter passes the node index along with operator events.
+    if (event_type != EventType::OPERATOR_INVOKE_EVENT || event_metadata1 < 0 || event_metadata1 >= static_cast<int64_t>(OP_PROFILER_MAX_OPS))
+        return no_event;
+
+    const size_t node = event_metadata1;
+
+    // Node 0 starts another invocation.
+    if (!node)
+        ++invocations;
+    if (node >= op_count)
+        op_count = node + 1;
+
+    ops[node].tag = tag;
+    ops[node].start = stage_ticks();
+    return node;
+}
+
+void OpProfiler::EndEvent(uint32_t event_handle)
+{
+    if (event_handle == no_event || !invocations)
+        return;
+
+    Op &op = ops[event_handle];
+    op.ticks[(invocations - 1) % OP_PROFILER_WINDOW] = stage_ticks() - op.start;
+}
+
+void OpProfiler::print() const
+{
+    const size_t window = invocations < OP_PROFILER_WINDOW ? invocations : OP_PROFILER_WINDOW;
+
+    if (!window) {
+        printf("No invocations profiled\r\n");
+        return;
+    }
+    uint32_t mean[OP_PROFILER_MAX_OPS];
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < op_count; ++i) {
+        uint64_t sum = 0;
+        for (size_t k = 0; k < window; ++k)
+            sum += ops[i].ticks[k];
+        mean[i] = sum / window;
+        total += mean[i];
+    }
+    printf("Last %u invocations\r\n", static_cast<unsigned>(window));
+    printf("%-4s %-20s %8s %8s %8s %6s\r\n", "node", "op", "min us", "mean us", "max us", "share");
+
+    for (size_t i = 0; i < op_count; ++i) {
+        uint32_t min = UINT32_MAX;
+        uint32_t max = 0;
+
+        for (size_t k = 0; k < window; ++k) {
+            if (ops[i].ticks[k] < min)
+                min = ops[i].ticks[k];
+            if (ops[i].ticks[k] > max)
+                max = ops[i].ticks[k];
+        }
+        printf("%-4u %-20s %8lu %8lu %8lu %5lu%%\r\n",
+            static_cast<unsigned>(i),
+            ops[i].tag ? ops[i].tag : "?",
+            static_cast<unsigned long>(stage_ticks_to_us(min)),
+            static_cast<unsigned long>(stage_ticks_to_us(mean[i])),
+            static_cast<unsigned long>(stage_ticks_to_us(max)),
+            static_cast<unsigned long>(total ? mean[i] * 100 / total : 0));
+    }
+    printf("%-25s %17lu\r\n", "total", static_cast<unsigned long>(stage_ticks_to_us(total)));
+}
+
+void OpProfiler::reset()
+{
+    for (auto &op : ops)
+        op = Op();
+    op_count = 0;
+    invocations = 0;
+}
@@ -0,0 +1,97 @@
+#include <cstdio>
+
+#include "pipeline.h"
+
+namespace {
+
+// Without voice for the whole span of the spectrogram the model can only say silence.
+constexpr uint32_t vad_window = FEATURE_SLICE_COUNT * FEATURE_SLICE_STRIDE_SAMPLES;
+
+}
+
+TfLiteStatus FeatureStage::process(bool &published)
+{
+    const auto current_sample = get_captured_audio_sample();
+    const bool inference_due = current_sample >= next_inference_sample;
+
+    published = false;
+
+    if (inference_due) {
+        next_inference_sample += cadence;
+        if (next_inference_sample <= current_sample)
+            next_inference_sample = current_sample + cadence;
+    }
+
+    // Skip the frontend and the model while there's no voice, but keep the recognizer
+    // fed. The spectrogram catches up with the skipped audio once voice comes back.
+    // Skipped audio is not dropped audio, release it so the capture doesn't count it.
+    if (get_silent_samples() >= vad_window) {
+        release_audio_samples(current_sample);
+        if (inference_due) {
+            exchange.begin_write();
+            exchange.publish({current_sample, false, stage_ticks()});
+            published = true;
+        }
+        return kTfLiteOk;
+    }
+
+    // Slices are computed as their audio arrives, the model only runs on cadence.
+    if (provider.populate_feature_data(current_sample) == -1) {
+        printf("FeatureProvider::populate_feature_data() failed\r\n");
+        return kTfLiteError;
+    }
+    if (inference_due) {
+        provider.copy_to(exchange.begin_write());
+        exchange.publish({current_sample, true, stage_ticks()});
+        published = true;
+    }
+    return kTfLiteOk;
+}
+
+bool InferenceStage::process(Command &cmd, int64_t &sample, TfLiteStatus &status)
+{
+    SpectrogramExchange::Header header;
+    uint32_t ticks = stage_ticks();
+
+    status = kTfLiteOk;
+
+    // The spectrogram goes straight into the input tensor, Invoke() has it to itself.
+    if (!exchange.read(interpreter.input(0)->data.int8, header, seen))
+        return false;
+
+    sample = header.sample;
+
+    if (!header.voice) {
+        cmd = recognizer.process_silence(sample, status);
+        if (status != kTfLiteOk) {
+            printf("RecognizeCommands::process_silence() failed\r\n");
+            return false;
+        }
+        ++skipped_inferences;
+        cmd = grammar.process(cmd, sample);
+        record_stage(STAGE_INFERENCE, header.ticks, deadline_us);
+        return true;
+    }
+    ticks = record_stage(STAGE_COPY, ticks);
+
+    // Run the model on the spectrogram input and make sure it succeeds.
+    if (interpreter.Invoke() != kTfLiteOk) {
+        printf("Invoke() failed\r\n");
+        status = kTfLiteError;
+        return false;
+    }
+    ++executed_inferences;
+    ticks = record_stage(STAGE_INVOKE, ticks);
+
+    // Determine whether a command was recognized based on the output of inference
+    cmd = recognizer.process_results(*interpreter.output(0), sample, status);
+
+    if (status != kTfLiteOk) {
+        printf("RecognizeCommands::process_results() failed\r\n");
+        return false;
+    }
+    cmd = grammar.process(cmd, sample);
+    record_stage(STAGE_RECOGNIZE, ticks);
+    record_stage(STAGE_INFERENCE, header.ticks, deadline_us);
+    return true;
+}
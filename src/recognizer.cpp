@@ -1,27 +1,93 @@
-#include <mbed.h>
+#include <algorithm>
+#include <cstdio>
 
 #include "recognizer.h"
 
-const uint8_t Recognizer::thresholds[N_LABELS] = {200, 215, 180, 180};
+namespace {
 
-Array<int32_t, N_LABELS> Recognizer::calculate_average()
+// log2(x) in Q8 fixed point, for 0 < x < 2^16.
+constexpr int32_t log2_q8(uint32_t x)
+{
+    int32_t result = 0;
+
+    while (x >> (result + 1))
+        ++result;
+
+    // Mantissa in [1, 2) as Q16, then one fractional bit per squaring.
+    uint64_t m = static_cast<uint64_t>(x) << (16 - result);
+
+    result <<= 8;
+    for (int32_t bit = 1 << 7; bit; bit >>= 1) {
+        m = m * m >> 16;
+        if (m >= 2u << 16) {
+            m >>= 1;
+            result |= bit;
+        }
+    }
+    return result;
+}
+
+static_assert(log2_q8(1) == 0 && log2_q8(2) == 1 << 8 && log2_q8(256) == 8 << 8, "");
+
+}
+
+
+void ScoreWindow::push_back(const int64_t time, const int8_t *scores_)
+{
+    if (count == capacity)
+        pop_front();
+
+    const size_t tail = (head + count++) & mask;
+    auto &block = scores[tail];
+
+    times[tail] = time;
+    for (size_t i = 0; i < N_LABELS; ++i) {
+        block[i] = scores_[i];
+        sums[i] += scores_[i] + 128;
+    }
+}
+
+void ScoreWindow::pop_front()
+{
+    const auto &block = scores[head];
+
+    for (size_t i = 0; i < N_LABELS; ++i)
+        sums[i] -= block[i] + 128;
+    head = (head + 1) & mask;
+    --count;
+}
+
+void ScoreWindow::clear()
+{
+    sums = {};
+    head = count = 0;
+}
+
+Array<int32_t, N_LABELS> ScoreWindow::average() const
 {
     Array<int32_t, N_LABELS> avg_scores;
 
-    for (const auto &it : prev_results) {
+    if (count) {
         for (size_t i = 0; i < N_LABELS; ++i)
-            avg_scores[i] += it.scores[i] + 128;
+            avg_scores[i] = sums[i] / static_cast<int32_t>(count);
     }
-    
-    for (auto &it : avg_scores)
-        it /= prev_results.size();
-
     return avg_scores;
 }
 
+bool Recognizer::set_config(const RecognizerConfig &config_)
+{
+    if (!valid_config(config_))
+        return false;
+
+    cfg = config_;
+    prev_results.clear();
+    started = false;
+    return true;
+}
+
 Command Recognizer::process_results(
     const TfLiteTensor &latest_results, 
-    const int32_t current_time_ms, 
+    const int64_t current_sample, 
     TfLiteStatus &status)
 {
     if (latest_results.dims->size != 2 ||
@@ -37,59 +103,211 @@ Command Recognizer::process_results(
             latest_results.type);
         status = kTfLiteError;
     }
-    if (!prev_results.empty() && current_time_ms < prev_results.front().time) {
-        printf("Results must be fed in increasing time order, but received a timestamp of %ld that was earlier than the previous one of %ld \n",
-            current_time_ms, prev_results.front().time);
+    if (status != kTfLiteOk) 
+        return Command();
+
+    return process_scores(latest_results.data.int8, current_sample, status);
+}
+
+Command Recognizer::process_silence(const int64_t current_sample, TfLiteStatus &status)
+{
+    Array<int8_t, N_LABELS> silence_scores;
+
+    for (auto &it : silence_scores)
+        it = -128;
+    silence_scores[SILENCE] = 127;
+
+    return process_scores(silence_scores.begin(), current_sample, status);
+}
+
+Command Recognizer::process_scores(
+    const int8_t *scores, 
+    const int64_t current_sample, 
+    TfLiteStatus &status)
+{
+    if (started && current_sample < last_sample) {
+        printf("Results must be fed in increasing time order, but received a timestamp of %ld ms that was earlier than the previous one of %ld ms \n",
+            static_cast<long>(samples_to_ms(current_sample)), static_cast<long>(samples_to_ms(last_sample)));
         status = kTfLiteError;
     }
     if (status != kTfLiteOk) 
         return Command();
 
+    if (!started) {
+        // The EWMA starts from confident silence, so that a single result can't trigger.
+        ewma = {};
+        ewma[SILENCE] = 255 << 8;
+        hmm_scores = {};
+        hmm_frames = {};
+        early_runs = {};
+        started = true;
+        last_sample = current_sample;
+    }
+    // An early command takes precedence, the smoothing is still kept up to date and
+    // its own decision for the same word is then suppressed.
+    const Command early = cfg.early_trigger ? trigger_early(scores, current_sample) : Command();
+    const Command smoothed = smooth(scores, current_sample);
+
+    last_sample = current_sample;
+
+    return early.is_new ? early : smoothed;
+}
+
+Command Recognizer::smooth(const int8_t *scores, const int64_t current_sample)
+{
+    switch (cfg.smoothing) {
+        case Smoothing::EWMA:       return smooth_ewma(scores, current_sample);
+        case Smoothing::HMM:        return smooth_hmm(scores, current_sample);
+        default:                    return smooth_average(scores, current_sample);
+    }
+}
+
+Command Recognizer::smooth_average(const int8_t *scores, const int64_t current_sample)
+{
     // Add the latest results to the head of the queue.
-    prev_results.push_back({current_time_ms, latest_results.data.int8});
+    prev_results.push_back(current_sample, scores);
 
     // Prune any earlier results that are too old for the averaging window.
-    const int64_t time_limit = current_time_ms - avg_window_duration_ms;
+    const int64_t time_limit = current_sample - cfg.avg_window_duration;
 
-    while (!prev_results.empty() && prev_results.front().time < time_limit)
+    while (!prev_results.empty() && prev_results.front_time() < time_limit)
         prev_results.pop_front();
 
     // If there are too few results, assume the result will be unreliable and bail.
-    const int64_t earliest_time = prev_results.front().time;
-    const int64_t samples_duration = current_time_ms - earliest_time;
+    const int64_t earliest_time = prev_results.front_time();
+    const int64_t samples_duration = current_sample - earliest_time;
 
-    if (prev_results.size() < min_count || samples_duration < (avg_window_duration_ms / 4)) {
-        // printf("Prev results: %d Samples_duration: %d", prev_results.size() < min_count, samples_duration < (avg_window_duration_ms / 4));
+    if (prev_results.size() < static_cast<size_t>(cfg.min_count) || samples_duration < (cfg.avg_window_duration >> 2)) {
+        // printf("Prev results: %d Samples_duration: %d", prev_results.size() < cfg.min_count, samples_duration < (cfg.avg_window_duration >> 2));
         return {prev_top_idx, 0, false};
     }
 
     // Calculate the average score across all the results in the window.
-    const auto scores = calculate_average();
+    const auto avg_scores = prev_results.average();
 
     // Find the current highest scoring category.
     uint8_t top_index = 0;
     int32_t top_score = 0;
 
     for (size_t i = 0; i < N_LABELS; ++i) {
-        if (scores[i] > top_score) {
-            top_score = scores[i];
+        if (avg_scores[i] > top_score) {
+            top_score = avg_scores[i];
+            top_index = i;
+        }
+    }
+    return decide(top_index, top_score, top_score > cfg.thresholds[top_index], current_sample);
+}
+
+Command Recognizer::smooth_ewma(const int8_t *scores, const int64_t current_sample)
+{
+    // Weight of the new result in Q15, dt / (tau + dt), so irregular intervals are fine.
+    const int64_t dt = current_sample - last_sample;
+    const int64_t alpha = (dt << 15) / (cfg.ewma_time_constant + dt);
+
+    uint8_t top_index = 0;
+    int32_t top_score = 0;
+
+    for (size_t i = 0; i < N_LABELS; ++i) {
+        const int32_t target = (scores[i] + 128) << 8;
+
+        ewma[i] += ((target - ewma[i]) * alpha) >> 15;
+        if ((ewma[i] >> 8) > top_score) {
+            top_score = ewma[i] >> 8;
             top_index = i;
         }
     }
+    return decide(top_index, top_score, top_score > cfg.thresholds[top_index], current_sample);
+}
+
+Command Recognizer::smooth_hmm(const int8_t *scores, const int64_t current_sample)
+{
+    // Each keyword is a left-to-right chain: filler -> keyword -> back to filler. The
+    // filler state emits the best non-keyword posterior and serves as the reference,
+    // so its path score is always 0 and the keyword state emits the log2 ratio of
+    // its posterior to the filler's. Viterbi then either stays in the keyword state
+    // or enters it afresh from the filler, whichever path scores higher.
+    int32_t filler = 0;
+
+    for (size_t i = 0; i < first_keyword; ++i)
+        filler = std::max<int32_t>(filler, scores[i] + 128);
+
+    const int32_t filler_log = log2_q8(filler + 1);
+
+    const int32_t hmm_ceiling = 2 * cfg.hmm_threshold;
+    uint8_t top_index = SILENCE;
+    int32_t top_path = 0;
+
+    for (size_t i = first_keyword; i < N_LABELS; ++i) {
+        const int32_t ratio = log2_q8(scores[i] + 129) - filler_log;
+
+        if (hmm_scores[i] > 0) {
+            hmm_scores[i] += ratio;
+            if (hmm_scores[i] > hmm_ceiling)
+                hmm_scores[i] = hmm_ceiling;
+            if (hmm_frames[i] < UINT8_MAX)
+                ++hmm_frames[i];
+        } else {
+            hmm_scores[i] = ratio;
+            hmm_frames[i] = 1;
+        }
+        if (hmm_scores[i] > top_path) {
+            top_path = hmm_scores[i];
+            top_index = i;
+        }
+    }
+    const int32_t top_score = top_path * 255 / hmm_ceiling;
+    const bool confident = top_path >= cfg.hmm_threshold && hmm_frames[top_index] >= cfg.hmm_min_frames;
+    const Command cmd = decide(top_index, top_score, confident, current_sample);
+
+    // A detection completes the path, decoding restarts from the filler state.
+    if (cmd.is_new) {
+        hmm_scores = {};
+        hmm_frames = {};
+    }
+    return cmd;
+}
+
+Command Recognizer::trigger_early(const int8_t *scores, const int64_t current_sample)
+{
+    uint8_t top_index = SILENCE;
+    int32_t top_score = 0;
+
+    for (size_t i = first_keyword; i < N_LABELS; ++i) {
+        const int32_t score = scores[i] + 128;
+
+        if (score <= cfg.early_threshold) {
+            early_runs[i] = 0;
+            continue;
+        }
+        if (early_runs[i] < UINT8_MAX)
+            ++early_runs[i];
+        if (early_runs[i] >= cfg.early_count && score > top_score) {
+            top_score = score;
+            top_index = i;
+        }
+    }
+    if (top_index == SILENCE)
+        return Command();
+
+    return decide(top_index, top_score, true, current_sample);
+}
+
+Command Recognizer::decide(uint8_t top_index, int32_t top_score, bool confident, const int64_t current_sample)
+{
     // If we've recently had another label trigger, assume one that occurs too
     // soon afterwards is a bad result.
-    int64_t time_since_last_top = current_time_ms - prev_top_time;
+    int64_t time_since_last_top = current_sample - prev_top_time;
 
     // if (prev_top_idx == SILENCE || prev_top_time == std::numeric_limits<int32_t>::min())
     // 	time_since_last_top = std::numeric_limits<int32_t>::max();
 
     bool is_new_command = false;
 
-    if (top_score > thresholds[top_index] && (top_index != prev_top_idx || time_since_last_top > suppression_ms)) {
+    if (confident && (top_index != prev_top_idx || time_since_last_top > cfg.suppression)) {
         prev_top_idx = top_index;
-        prev_top_time = current_time_ms;
+        prev_top_time = current_sample;
         is_new_command = true;
     }
 
-    return {top_index, top_score, is_new_command};
-}
+    return {top_index, static_cast<uint8_t>(top_score), is_new_command};
+}
\ No newline at end of file
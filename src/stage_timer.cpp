@@ -0,0 +1,137 @@
+#include <atomic>
+#include <cstdio>
+
+#include "stage_timer.h"
+
+#ifdef ARDUINO
+#include <mbed.h>
+#else
+#include <chrono>
+#endif
+
+namespace {
+
+struct StageRecord {
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint32_t> overruns{0};
+    std::atomic<uint32_t> max_us{0};
+    std::atomic<uint32_t> bins[STAGE_HISTOGRAM_BINS] = {};
+};
+
+StageRecord records[N_STAGES];
+
+#ifdef ARDUINO
+uint32_t ticks_per_us = 1;
+#else
+constexpr uint32_t ticks_per_us = 1;
+#endif
+
+size_t histogram_bin(uint32_t us)
+{
+    size_t bin = 0;
+
+    while (us >>= 1)
+        ++bin;
+    return bin < STAGE_HISTOGRAM_BINS ? bin : STAGE_HISTOGRAM_BINS - 1;
+}
+
+// Counters have a single writer, a relaxed load and store is enough to bump them.
+void bump(std::atomic<uint32_t> &counter)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+}
+
+uint32_t StageStats::percentile_us(uint32_t percent) const
+{
+    const uint64_t target = (static_cast<uint64_t>(count) * percent + 99) / 100;
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < STAGE_HISTOGRAM_BINS; ++i) {
+        seen += bins[i];
+        if (seen >= target && seen)
+            return i + 1 < STAGE_HISTOGRAM_BINS && (2u << i) < max_us ? 2u << i : max_us;
+    }
+    return max_us;
+}
+
+void init_stage_timer()
+{
+#ifdef ARDUINO
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    ticks_per_us = SystemCoreClock / 1000000;
+#endif
+}
+
+uint32_t stage_ticks()
+{
+#ifdef ARDUINO
+    return DWT->CYCCNT;
+#else
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+uint32_t stage_ticks_to_us(uint32_t ticks)
+{
+    return ticks / ticks_per_us;
+}
+
+uint32_t record_stage(Stage stage, uint32_t start, uint32_t deadline_us)
+{
+    const uint32_t now = stage_ticks();
+    const uint32_t us = stage_ticks_to_us(now - start);
+    StageRecord &record = records[stage];
+
+    bump(record.bins[histogram_bin(us)]);
+    bump(record.count);
+    if (us > deadline_us)
+        bump(record.overruns);
+    if (us > record.max_us.load(std::memory_order_relaxed))
+        record.max_us.store(us, std::memory_order_relaxed);
+    return now;
+}
+
+StageStats get_stage_stats(Stage stage)
+{
+    const StageRecord &record = records[stage];
+    StageStats stats;
+
+    stats.count = record.count.load(std::memory_order_relaxed);
+    stats.overruns = record.overruns.load(std::memory_order_relaxed);
+    stats.max_us = record.max_us.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < STAGE_HISTOGRAM_BINS; ++i)
+        stats.bins[i] = record.bins[i].load(std::memory_order_relaxed);
+    return stats;
+}
+
+void reset_stage_stats()
+{
+    for (auto &record : records) {
+        record.count.store(0, std::memory_order_relaxed);
+        record.overruns.store(0, std::memory_order_relaxed);
+        record.max_us.store(0, std::memory_order_relaxed);
+        for (auto &bin : record.bins)
+            bin.store(0, std::memory_order_relaxed);
+    }
+}
+
+void print_stage_stats()
+{
+    printf("%-10s %8s %8s %8s %8s %8s\r\n", "stage", "count", "p50 us", "p99 us", "max us", "overruns");
+
+    for (size_t i = 0; i < N_STAGES; ++i) {
+        const StageStats stats = get_stage_stats(static_cast<Stage>(i));
+
+        printf("%-10s %8lu %8lu %8lu %8lu %8lu\r\n", STAGE_NAMES[i],
+            static_cast<unsigned long>(stats.count),
+            static_cast<unsigned long>(stats.percentile_us(50)),
+            static_cast<unsigned long>(stats.percentile_us(99)),
+            static_cast<unsigned long>(stats.max_us),
+            static_cast<unsigned long>(stats.overruns));
+    }
+}
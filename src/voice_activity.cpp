@@ -0,0 +1,27 @@
+#include "voice_activity.h"
+
+bool VoiceActivityDetector::process(const int16_t *samples, size_t count)
+{
+    if (!count)
+        return false;
+
+    uint32_t sum = 0;
+    for (size_t i = 0; i < count; ++i)
+        sum += samples[i] < 0 ? -samples[i] : samples[i];
+
+    const uint32_t level = sum / count;
+    const uint32_t scaled_level = level << floor_bits;
+
+    if (!initialized) {
+        noise_floor = scaled_level;
+        initialized = true;
+    }
+    const bool is_voice = level >= min_voice_level && scaled_level > noise_floor * voice_ratio;
+
+    if (scaled_level < noise_floor)
+        noise_floor -= (noise_floor - scaled_level) >> fall_shift;
+    else
+        noise_floor += ((scaled_level - noise_floor) >> rise_shift) + 1;
+
+    return is_voice;
+}
\ No newline at end of file
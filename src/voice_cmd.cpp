@@ -6,26 +6,37 @@
 #include <tensorflow/lite/micro/all_ops_resolver.h>
 #include <tensorflow/lite/version.h>
 
+#include <new>
+
 #include "audio_provider.h"
-#include "feature_provider.h"
+#include "grammar.h"
+#include "memory_budget.h"
 #include "model.h"
+#include "op_profiler.h"
 #include "recognizer.h"
 #include "voice_cmd.h"
 
 namespace {
 
-events::EventQueue event_queue{32 * EVENTS_EVENT_SIZE};
+events::EventQueue event_queue{EVENT_QUEUE_SIZE};
 
-Array<int8_t, FEATURE_ELEMENT_COUNT> feature_buffer = {};
 const auto model = tflite::GetModel(g_model);
-const auto feature_provider = FeatureProvider(feature_buffer);
-auto recognizer = Recognizer();
+OpProfiler op_profiler;
+auto recognizer = Recognizer(RECOGNIZER_PROFILES[BALANCED]);
+
+constexpr auto grammar_table = build_grammar<8>(GRAMMAR_RULES);
+static_assert(grammar_table.valid, "GRAMMAR_RULES don't fit the table or are ambiguous");
+auto grammar = Grammar(grammar_table);
 
 mbed::DigitalOut LED(digitalPinToPinName(LED_BUILTIN), LOW);
 mbed::DigitalOut LED_R(digitalPinToPinName(LEDR), HIGH);
 mbed::DigitalOut LED_G(digitalPinToPinName(LEDG), HIGH);
 mbed::DigitalOut LED_B(digitalPinToPinName(LEDB), HIGH);
 
+#ifdef MODEL_ARENA
+static_assert(model_arena::model_len == g_model_len, "model_arena.h is for another model, regenerate it");
+#endif
+
 } // namespace
 
 void schedule_ble_events(BLE::OnEventsToProcessCallbackContext *context) 
@@ -35,8 +46,8 @@ void schedule_ble_events(BLE::OnEventsToProcessCallbackContext *context)
 
 VoiceCmdService::VoiceCmdService(BLE &ble_) : ble(ble_)
 {
-    MBED_ASSERT(cmd < N_LABELS);
-    GattCharacteristic *char_table[] = { &characteristic };
+    MBED_ASSERT(cmd < N_COMMANDS);
+    GattCharacteristic *char_table[] = { &characteristic, &config_characteristic, &stats_characteristic };
     GattService vl_service(
         UUID_SERVICE,
         char_table,
@@ -47,19 +58,50 @@ VoiceCmdService::VoiceCmdService(BLE &ble_) : ble(ble_)
 
 void VoiceCmdService::update_command(uint8_t cmd_)
 {
-    MBED_ASSERT(cmd_ < N_LABELS);
+    MBED_ASSERT(cmd_ < N_COMMANDS);
     cmd = cmd_;
     ble.gattServer().write(characteristic.getValueHandle(), &cmd, 1);
 }
 
+void VoiceCmdService::update_config(uint8_t profile, const RecognizerConfig &config)
+{
+    config_value[0] = profile;
+    for (size_t i = 0; i < N_LABELS; ++i)
+        config_value[1 + i] = config.thresholds[i];
+    ble.gattServer().write(config_characteristic.getValueHandle(), config_value, CONFIG_VALUE_SIZE);
+}
+
+void VoiceCmdService::update_stats()
+{
+    uint8_t *dst = stats_value;
+
+    for (size_t i = 0; i < N_STAGES; ++i) {
+        const StageStats stats = get_stage_stats(static_cast<Stage>(i));
+        const uint32_t fields[STATS_STAGE_FIELDS] = {
+            stats.count,
+            stats.percentile_us(50),
+            stats.percentile_us(99),
+            stats.max_us,
+            stats.overruns,
+        };
+        for (auto field : fields) {
+            for (size_t b = 0; b < sizeof(field); ++b)
+                *dst++ = field >> 8 * b;
+        }
+    }
+    ble.gattServer().write(stats_characteristic.getValueHandle(), stats_value, STATS_VALUE_SIZE);
+}
+
 void VoiceCmd::start() 
 {
     using namespace std::chrono;
 
     ble.gap().setEventHandler(this);
+    ble.gattServer().setEventHandler(this);
     ble.init(this, &VoiceCmd::on_init);
 
     respond_event = event_queue.call_every(1s, this, &VoiceCmd::waiting_blink);
+    event_queue.call_every(STATS_PERIOD, this, &VoiceCmd::monitor);
     event_queue.dispatch_forever();
 }
 
@@ -77,8 +119,9 @@ void VoiceCmd::on_init(BLE::InitializationCompleteCallbackContext *params)
     }
     // Static reporter to initialize interpreter.
     static tflite::MicroErrorReporter static_reporter;
-    // Create an area of memory to use for input, output, and intermediate arrays.
-    static uint8_t tensor_arena[TENSOR_ARENA_SIZE];
+    // Create an area of memory to use for input, output, and intermediate arrays, with
+    // the scratch buffers after it.
+    alignas(16) static uint8_t tensor_arena[ARENA_BLOCK_SIZE];
     // Pull in only the operation implementations we need.
     // This relies on a complete list of all the ops needed by this graph.
     // An easier approach is to just use the AllOpsResolver, but this will
@@ -92,13 +135,22 @@ void VoiceCmd::on_init(BLE::InitializationCompleteCallbackContext *params)
     if (micro_op_resolver.AddReshape() != kTfLiteOk) return;
     // static tflite::AllOpsResolver micro_op_resolver;
     // Build an interpreter to run the model with.
-    static tflite::MicroInterpreter static_interpreter(model, micro_op_resolver, tensor_arena, TENSOR_ARENA_SIZE, &static_reporter);
-    interpreter = &static_interpreter;
-    // Allocate memory from the tensor_arena for the model's tensors.
+    static tflite::MicroInterpreter static_interpreter(model, micro_op_resolver, tensor_arena, INTERPRETER_ARENA_SIZE, &static_reporter, &op_profiler);
+    tflite::MicroInterpreter *interpreter = &static_interpreter;
+
+    // Allocate memory from the tensor_arena for the model's tensors, the scratch takes the
+    // rest of the block.
     if (interpreter->AllocateTensors() != kTfLiteOk) {
-        printf("AllocateTensors() failed\r\n");
+        printf("AllocateTensors() failed, the tensor arena has no room for the scratch\r\n");
         return;
     }
+    ArenaScratch *scratch = new (&tensor_arena[INTERPRETER_ARENA_SIZE]) ArenaScratch();
+
+    printf("Tensor arena: %u of %u bytes used, %u bytes of scratch after it\r\n",
+        static_cast<unsigned>(interpreter->arena_used_bytes()), static_cast<unsigned>(INTERPRETER_ARENA_SIZE),
+        static_cast<unsigned>(ARENA_SCRATCH_SIZE));
+    printf("Memory budget: %u of %u bytes\r\n",
+        static_cast<unsigned>(memory_budget_total()), static_cast<unsigned>(VOICE_CMD_RAM_BUDGET));
     TfLiteTensor *model_input = nullptr;
     // Get information about the memory area to use for the model's input.
     model_input = interpreter->input(0);
@@ -110,18 +162,36 @@ void VoiceCmd::on_init(BLE::InitializationCompleteCallbackContext *params)
         printf("Bad input tensor parameters in model\r\n");
         return;
     }
-    model_input_buffer = model_input->data.int8;
-    previous_time = 0;
+
+    // The feature thread keeps the spectrogram in its own store while Invoke() runs on
+    // the input tensor, and hands it over through the exchange.
+    static FeatureProvider feature_provider(scratch->feature_store);
+    SpectrogramExchange &exchange = scratch->exchange;
+    static FeatureStage static_feature_stage(feature_provider, exchange, INFERENCE_SLICE_CADENCE * FEATURE_SLICE_STRIDE_SAMPLES);
+    // An inference should be done before the next spectrogram is due.
+    static InferenceStage static_inference_stage(*interpreter, exchange, recognizer, grammar,
+        samples_to_ms(INFERENCE_SLICE_CADENCE * FEATURE_SLICE_STRIDE_SAMPLES) * 1000);
+    feature_stage = &static_feature_stage;
+    inference_stage = &static_inference_stage;
 
     if (init_micro_features() != kTfLiteOk) {
         printf("init_micro_features() failed\r\n");
         return;
     }
 
-    if (init_audio_recording() != kTfLiteOk) {
+    if (init_audio_recording(audio_source) != kTfLiteOk) {
         printf("init_audio_recording() failed\r\n");
         return;
     }
+    init_stage_timer();
+
+    if (feature_thread.start(mbed::callback(this, &VoiceCmd::feature_loop)) != osOK ||
+        inference_thread.start(mbed::callback(this, &VoiceCmd::inference_loop)) != osOK)
+    {
+        printf("Pipeline threads failed to start\r\n");
+        return;
+    }
+    service.update_config(profile, config);
     print_mac_address();
     start_advertising();
 }
@@ -169,53 +239,58 @@ void VoiceCmd::start_advertising()
     }
 }
 
-void VoiceCmd::inference() 
+void VoiceCmd::audio_stride_ready(void *context)
 {
-    // Fetch the spectrogram for the current time.
-    const auto current_time = get_latest_audio_timestamp();
-    const auto num_new_slices = feature_provider.populate_feature_data(previous_time, current_time);
-
-    if (num_new_slices == -1) {
-        printf("FeatureProvider::populate_feature_data() failed\r\n");
-        return;
-    }
-    previous_time = current_time;
-    // If no new audio samples have been received since last time, don't bother.
-    if (!num_new_slices) 
-        return;
+    // Raising an already raised signal is a no-op, one wake up processes everything
+    // captured by the time the feature thread runs.
+    static_cast<VoiceCmd*>(context)->audio_signal.raise();
+}
 
-    // Copy feature buffer to input tensor
-    for (size_t i = 0; i < FEATURE_ELEMENT_COUNT; i++)
-        model_input_buffer[i] = feature_buffer[i];
+void VoiceCmd::feature_loop()
+{
+    while (true) {
+        audio_signal.wait();
 
-    // Run the model on the spectrogram input and make sure it succeeds.
-    if (interpreter->Invoke() != kTfLiteOk) {
-        printf("Invoke() failed\r\n");
-        return;
+        bool published = false;
+        if (feature_stage->process(published) == kTfLiteOk && published)
+            spectrogram_signal.raise();
     }
+}
 
-    // Obtain a pointer to the output tensor
-    TfLiteTensor *output = interpreter->output(0);
-    // Determine whether a command was recognized based on the output of inference
-    TfLiteStatus process_status = kTfLiteOk;
-    Command cmd = recognizer.process_results(*output, current_time, process_status);
+void VoiceCmd::inference_loop()
+{
+    while (true) {
+        spectrogram_signal.wait();
 
-    if (process_status != kTfLiteOk) {
-        printf("RecognizeCommands::process_results() failed\r\n");
-        return;
+        config_mutex.lock();
+        if (config_pending) {
+            recognizer.set_config(config);
+            config_pending = false;
+        }
+        config_mutex.unlock();
+
+        Command cmd;
+        int64_t current_sample;
+        TfLiteStatus status;
+
+        // LEDs and GATT belong to the event queue, the result is handed over there.
+        if (inference_stage->process(cmd, current_sample, status))
+            event_queue.call([this, current_sample, cmd] {
+                const uint32_t ticks = stage_ticks();
+                respond(current_sample, cmd);
+                record_stage(STAGE_RESPOND, ticks);
+            });
     }
-    
-    // printf("CMD: %u [%u] %u \r\n", cmd.found_command, cmd.score, cmd.is_new);
-    respond(current_time, cmd);
 }
 
-void VoiceCmd::respond(int32_t current_time, const Command &cmd) 
+void VoiceCmd::respond(int64_t current_sample, const Command &cmd) 
 {
-    static int32_t last_cmd_time = 0;
+    const int64_t hold = config.hold;
+    static int64_t last_cmd_time = 0;
 
-    if (cmd.is_new && last_cmd_time < current_time - 1500) {
+    if (shown_after_hold(cmd, current_sample, last_cmd_time, hold)) {
 
-        printf("Heard %s [%d] %ld ms\n", LABELS[cmd.found_command], cmd.score, current_time);
+        printf("Heard %s [%d] %ld ms\n", command_name(cmd.found_command), cmd.score, static_cast<long>(samples_to_ms(current_sample)));
 
         LED = LOW;
         LED_R = LED_G = LED_B = HIGH;
@@ -226,15 +301,17 @@ void VoiceCmd::respond(int32_t current_time, const Command &cmd)
             case UNKNOWN:   LED_B = LOW; break;	// Blue for unknown
             case ON:        LED_G = LOW; break;	// Green for on
             case OFF:       LED_R = LOW; break;	// Red for off
+            case ON_OFF:    LED_R = LED_G = LOW; break;	// Yellow for on, off
+            case OFF_ON:    LED_G = LED_B = LOW; break;	// Cyan for off, on
         }
         if (cmd.found_command != SILENCE) 
-            last_cmd_time = current_time;
+            last_cmd_time = current_sample;
 
         service.update_command(cmd.found_command);
     }
     // If last_command_time is non-zero but was > 3 seconds ago, zero it and switch off the LED.
     if (last_cmd_time) {
-        if (last_cmd_time < current_time - 1500) {
+        if (last_cmd_time < current_sample - hold) {
             last_cmd_time = 0;
             LED = LOW;
             LED_R = LED_G = LED_B = HIGH;
@@ -246,6 +323,30 @@ void VoiceCmd::respond(int32_t current_time, const Command &cmd)
     LED = !LED;
 }
 
+void VoiceCmd::monitor()
+{
+    while (Serial.available() > 0) {
+        switch (Serial.read()) {
+            case 's': {
+                const AudioStats audio = get_audio_stats();
+                print_stage_stats();
+                printf("Audio: %lu overruns, %lu dropped blocks\r\n",
+                    static_cast<unsigned long>(audio.overruns), static_cast<unsigned long>(audio.dropped_blocks));
+                break;
+            }
+            case 'p':
+                op_profiler.print();
+                break;
+            case 'r':
+                reset_stage_stats();
+                op_profiler.reset();
+                printf("Stage stats and op profile reset\r\n");
+                break;
+        }
+    }
+    service.update_stats();
+}
+
 void VoiceCmd::waiting_blink()
 {
     LED_R = LED_G = LED_B = !LED_R;
@@ -255,7 +356,10 @@ void VoiceCmd::onDisconnectionComplete(const ble::DisconnectionCompleteEvent&)
 {
     using namespace std::chrono;
 
+    set_audio_stride_handler(nullptr, nullptr);
     LED = LOW;
+    printf("Inferences: %lu executed, %lu skipped without voice\r\n",
+        static_cast<unsigned long>(inference_stage->executed()), static_cast<unsigned long>(inference_stage->skipped()));
     ble.gap().startAdvertising(ble::LEGACY_ADVERTISING_HANDLE);
     event_queue.cancel(respond_event);
     respond_event = event_queue.call_every(1s, this, &VoiceCmd::waiting_blink);
@@ -263,12 +367,40 @@ void VoiceCmd::onDisconnectionComplete(const ble::DisconnectionCompleteEvent&)
 
 void VoiceCmd::onConnectionComplete(const ble::ConnectionCompleteEvent &event)
 {
-    using namespace std::chrono;
-
     LED_R = LED_G = LED_B = HIGH;
     event_queue.cancel(respond_event);
     if (event.getStatus() == BLE_ERROR_NONE)
-        respond_event = event_queue.call_every(200ms, this, &VoiceCmd::inference);
+        set_audio_stride_handler(&VoiceCmd::audio_stride_ready, this);
+}
+
+void VoiceCmd::onDataWritten(const GattWriteCallbackParams &params)
+{
+    if (params.handle != service.config_handle())
+        return;
+
+    if (params.len != CONFIG_VALUE_SIZE || params.data[0] >= N_PROFILES) {
+        printf("Bad recognizer config of %u bytes\r\n", params.len);
+        service.update_config(profile, config);
+        return;
+    }
+    RecognizerConfig written = RECOGNIZER_PROFILES[params.data[0]];
+
+    for (size_t i = 0; i < N_LABELS; ++i) {
+        if (params.data[1 + i])
+            written.thresholds[i] = params.data[1 + i];
+    }
+    // The recognizer belongs to the inference thread, which applies the config itself.
+    if (valid_config(written)) {
+        config_mutex.lock();
+        config = written;
+        config_pending = true;
+        config_mutex.unlock();
+        profile = params.data[0];
+    } else {
+        printf("Recognizer config rejected\r\n");
+    }
+    printf("Recognizer profile %u\r\n", profile);
+    service.update_config(profile, config);
 }
 
 void VoiceCmd::print_mac_address()
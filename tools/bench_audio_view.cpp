@@ -0,0 +1,120 @@
+// Compares reading feature windows from the capture ring through a view, the way
+// FeatureProvider does, against copying each window into a staging buffer first, the
+// way it did before views. Both paths then apply the frontend's window function to
+// the samples, the first thing the frontend does with them. Build on the host and
+// run from the repo root:
+//
+//   g++ -std=c++14 -O2 -I include -I <tflite-micro> tools/bench_audio_view.cpp
+//       -o bench_audio_view
+//   ./bench_audio_view [windows]
+//
+// Host timings, compare the two paths with each other rather than with the device.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "audio_provider.h"
+#include "capture_ring.h"
+#include "model_settings.h"
+
+namespace {
+
+constexpr size_t capture_samples = AUDIO_CAPTURE_SAMPLES;
+constexpr size_t window_samples = FEATURE_SLICE_DURATION_SAMPLES;
+
+CaptureRing<int16_t, capture_samples> ring;
+int16_t staging[MAX_AUDIO_SAMPLE_SIZE];
+int16_t coefficients[window_samples];
+int16_t windowed[window_samples];
+// Keeps the compiler from dropping the work.
+int64_t checksum = 0;
+
+// What the frontend's window stage does with the samples: Q14 Hann window. Not
+// inlined, the frontend is built separately and only ever sees a pointer.
+__attribute__((noinline)) void apply_window(const int16_t *samples, size_t count, size_t offset)
+{
+    for (size_t i = 0; i < count; ++i)
+        windowed[offset + i] = (static_cast<int32_t>(samples[i]) * coefficients[offset + i]) >> 14;
+    for (size_t i = 0; i < count; ++i)
+        checksum += windowed[offset + i];
+}
+
+// Before views: copy the window out of the ring, then hand the copy on.
+void read_copy(uint32_t start)
+{
+    for (size_t i = 0; i < window_samples; ++i)
+        staging[i] = *ring.at(start + i);
+    if (ring.intact(start))
+        apply_window(staging, window_samples, 0);
+}
+
+// Views: hand the ring on in place, in two parts when the window wraps.
+void read_view(uint32_t start)
+{
+    const size_t index = start & (capture_samples - 1);
+    const size_t first_size = window_samples < capture_samples - index ? window_samples : capture_samples - index;
+
+    apply_window(ring.at(start), first_size, 0);
+    if (first_size < window_samples)
+        apply_window(ring.at(0), window_samples - first_size, first_size);
+    ring.intact(start);
+}
+
+template<class Read>
+double time_windows(Read read, long windows)
+{
+    const auto start = std::chrono::steady_clock::now();
+    uint32_t seq = 0;
+
+    for (long i = 0; i < windows; ++i) {
+        read(seq);
+        // Go round the ring, which holds the same audio all along. Some windows wrap.
+        seq = (seq + FEATURE_SLICE_STRIDE_SAMPLES) % capture_samples;
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / windows;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const long windows = argc > 1 ? strtol(argv[1], nullptr, 10) : 1000000;
+
+    if (argc > 2 || windows <= 0) {
+        fprintf(stderr, "Usage: %s [windows]\n", argv[0]);
+        return 1;
+    }
+    for (size_t i = 0; i < window_samples; ++i)
+        coefficients[i] = (1 << 14) * 0.5 * (1 - cos(2 * M_PI * (i + 0.5) / window_samples));
+
+    // Fill the whole ring once, nothing overwrites it afterwards.
+    for (size_t block = 0; block < capture_samples / AUDIO_BLOCK_SAMPLES; ++block) {
+        int16_t *samples = ring.prepare(AUDIO_BLOCK_SAMPLES);
+        for (size_t i = 0; i < AUDIO_BLOCK_SAMPLES; ++i)
+            samples[i] = rand() - RAND_MAX / 2;
+        ring.commit(AUDIO_BLOCK_SAMPLES);
+    }
+    // Warm up, then alternate to even out frequency scaling.
+    time_windows(read_copy, windows / 10);
+    time_windows(read_view, windows / 10);
+
+    double copy_ns = 0;
+    double view_ns = 0;
+
+    for (int round = 0; round < 4; ++round) {
+        copy_ns += time_windows(read_copy, windows / 4);
+        view_ns += time_windows(read_view, windows / 4);
+    }
+    copy_ns /= 4;
+    view_ns /= 4;
+
+    printf("%-6s %10s\n", "path", "ns/window");
+    printf("%-6s %10.1f\n", "copy", copy_ns);
+    printf("%-6s %10.1f\n", "view", view_ns);
+    printf("view saves %.1f ns per window, %.0f%%\n", copy_ns - view_ns, 100 * (copy_ns - view_ns) / copy_ns);
+    printf("checksum %lld\n", static_cast<long long>(checksum));
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Featurizes the same audio on several threads at once, one FeatureExtractor each,
+// checks that every thread's features are bit-identical to the default instance's
+// run on one thread, and reports the throughput. Build on the host against TFLM and
+// run from the repo root:
+//
+//   g++ -std=c++14 -O2 -pthread -I include -I <tflite-micro> tools/bench_feature_extractor.cpp
+//       src/features_generator.cpp src/features_quantizer.cpp src/frontend_config.cpp
+//       src/frontend_fft.cpp <tflite-micro library> -o bench_feature_extractor
+//   ./bench_feature_extractor [threads] [seconds]
+//
+// The audio is pseudo-random noise with a few tones, deterministic from run to run.
+// It is streamed in blocks of AUDIO_BLOCK_SAMPLES like the capture path delivers it.
+// Exits with 1 if any thread's features differ.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "audio_source.h"
+#include "features_generator.h"
+#include "model_settings.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<int16_t> make_audio(size_t samples)
+{
+    std::vector<int16_t> audio(samples);
+    uint32_t seed = 1;
+
+    for (size_t i = 0; i < samples; ++i) {
+        seed = seed * 1664525 + 1013904223;
+        const double t = static_cast<double>(i) / AUDIO_SAMPLE_FREQUENCY;
+        const double tones = 3000 * sin(2 * M_PI * 440 * t) + 1500 * sin(2 * M_PI * 1800 * t) * sin(2 * M_PI * 3 * t);
+        audio[i] = static_cast<int16_t>(tones + static_cast<int16_t>(seed >> 16) / 16);
+    }
+    return audio;
+}
+
+// Streams the audio through either extractor, the default one when extractor is null.
+bool featurize(FeatureExtractor *extractor, const std::vector<int16_t> &audio, std::vector<int8_t> &features)
+{
+    int8_t slices[2 * FEATURE_SLICE_SIZE];
+
+    features.clear();
+    for (size_t offset = 0; offset < audio.size(); offset += AUDIO_BLOCK_SAMPLES) {
+        const size_t count = std::min(AUDIO_BLOCK_SAMPLES, audio.size() - offset);
+        size_t num_slices, num_samples_read;
+        const TfLiteStatus status = extractor ?
+            extractor->stream(&audio[offset], count, slices, 2, &num_slices, &num_samples_read) :
+            stream_micro_features(&audio[offset], count, slices, 2, &num_slices, &num_samples_read);
+
+        // A block completes at most one stride, two slices always fit.
+        if (status != kTfLiteOk || num_samples_read != count)
+            return false;
+        features.insert(features.end(), slices, slices + num_slices * FEATURE_SLICE_SIZE);
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const long threads = argc > 1 ? strtol(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+    const double seconds = argc > 2 ? strtod(argv[2], nullptr) : 60;
+
+    if (argc > 3 || threads <= 0 || seconds <= 0) {
+        fprintf(stderr, "Usage: %s [threads] [seconds]\n", argv[0]);
+        return 1;
+    }
+    const std::vector<int16_t> audio = make_audio(seconds * AUDIO_SAMPLE_FREQUENCY);
+    std::vector<int8_t> reference;
+
+    if (init_micro_features() != kTfLiteOk) {
+        fprintf(stderr, "init_micro_features() failed\n");
+        return 1;
+    }
+    // Reference: the default instance behind the global functions, on this thread.
+    auto start = Clock::now();
+    if (!featurize(nullptr, audio, reference)) {
+        fprintf(stderr, "stream_micro_features() failed\n");
+        return 1;
+    }
+    const double single_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Construct and initialize up front, so the timing covers featurizing only.
+    std::vector<FeatureExtractor> extractors(threads);
+    std::vector<std::vector<int8_t>> outputs(threads);
+    std::vector<char> ok(threads);
+    std::vector<std::thread> workers;
+
+    for (auto &extractor : extractors) {
+        if (extractor.init() != kTfLiteOk) {
+            fprintf(stderr, "FeatureExtractor::init() failed\n");
+            return 1;
+        }
+    }
+    start = Clock::now();
+    for (long i = 0; i < threads; ++i)
+        workers.emplace_back([&, i] { ok[i] = featurize(&extractors[i], audio, outputs[i]); });
+    for (auto &worker : workers)
+        worker.join();
+    const double parallel_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    long identical = 0;
+    for (long i = 0; i < threads; ++i) {
+        if (!ok[i])
+            fprintf(stderr, "Thread %ld: FeatureExtractor::stream() failed\n", i);
+        else if (outputs[i] != reference)
+            fprintf(stderr, "Thread %ld: features differ from the single-instance run\n", i);
+        else
+            ++identical;
+    }
+    const size_t slices = reference.size() / FEATURE_SLICE_SIZE;
+
+    printf("%.0f s of audio, %zu slices per stream\n", seconds, slices);
+    printf("%-8s %10s %14s\n", "threads", "wall s", "slices/s");
+    printf("%-8d %10.3f %14.0f\n", 1, single_s, slices / single_s);
+    printf("%-8ld %10.3f %14.0f\n", threads, parallel_s, threads * slices / parallel_s);
+    printf("identical: %ld of %ld\n", identical, threads);
+    return identical == threads ? 0 : 1;
+}
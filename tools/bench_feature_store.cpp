@@ -0,0 +1,112 @@
+// Compares keeping the spectrogram as a ring of slices, as FeatureProvider does,
+// against the former flat store that shifted all kept slices down for every update
+// and was then copied element by element into the input tensor. Only the store
+// bookkeeping is timed: new slices are filled with a constant instead of running the
+// frontend, which costs the same either way. Build on the host and run from the repo
+// root:
+//
+//   g++ -std=c++14 -O2 -I include tools/bench_feature_store.cpp -o bench_feature_store
+//   ./bench_feature_store [ticks]
+//
+// Each tick adds the slices since the last model run and hands the spectrogram to
+// the model, for 1 slice per tick and for 10, the device's cadence. Host timings,
+// the byte loops of the shift may be vectorized here but not on the device.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#include "model_settings.h"
+
+namespace {
+
+int8_t store[FEATURE_ELEMENT_COUNT];
+int8_t input[FEATURE_ELEMENT_COUNT];
+size_t head = 0;
+
+// Former FeatureProvider::shift_slices().
+__attribute__((noinline)) void shift_slices(const size_t slices_to_keep)
+{
+    const size_t slices_to_drop = FEATURE_SLICE_COUNT - slices_to_keep;
+
+    for (size_t dst_slice = 0; dst_slice < slices_to_keep; ++dst_slice) {
+        int8_t *dst_slice_data = &store[dst_slice * FEATURE_SLICE_SIZE];
+        const int8_t *src_slice_data = &store[(dst_slice + slices_to_drop) * FEATURE_SLICE_SIZE];
+
+        for (size_t i = 0; i < FEATURE_SLICE_SIZE; ++i)
+            dst_slice_data[i] = src_slice_data[i];
+    }
+}
+
+void shift_tick(size_t new_slices, int8_t value)
+{
+    const size_t slices_to_keep = FEATURE_SLICE_COUNT - new_slices;
+
+    shift_slices(slices_to_keep);
+    for (size_t slice = slices_to_keep; slice < FEATURE_SLICE_COUNT; ++slice)
+        memset(&store[slice * FEATURE_SLICE_SIZE], value, FEATURE_SLICE_SIZE);
+
+    // Former copy into the input tensor in VoiceCmd::inference().
+    for (size_t i = 0; i < FEATURE_ELEMENT_COUNT; ++i)
+        input[i] = store[i];
+}
+
+// FeatureProvider: new slices replace the oldest in place, copy_to() unrolls the ring.
+void ring_tick(size_t new_slices, int8_t value)
+{
+    for (size_t i = 0; i < new_slices; ++i) {
+        memset(&store[head * FEATURE_SLICE_SIZE], value, FEATURE_SLICE_SIZE);
+        if (++head == FEATURE_SLICE_COUNT)
+            head = 0;
+    }
+    const size_t head_offset = head * FEATURE_SLICE_SIZE;
+
+    memcpy(input, &store[head_offset], FEATURE_ELEMENT_COUNT - head_offset);
+    memcpy(input + FEATURE_ELEMENT_COUNT - head_offset, &store[0], head_offset);
+}
+
+template<class Tick>
+double time_ticks(Tick tick, size_t new_slices, long ticks)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    for (long i = 0; i < ticks; ++i)
+        tick(new_slices, static_cast<int8_t>(i));
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ticks;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const long ticks = argc > 1 ? strtol(argv[1], nullptr, 10) : 1000000;
+
+    if (argc > 2 || ticks <= 0) {
+        fprintf(stderr, "Usage: %s [ticks]\n", argv[0]);
+        return 1;
+    }
+    printf("%-7s %12s %12s\n", "slices", "shift ns", "ring ns");
+
+    for (size_t new_slices : {size_t(1), size_t(10)}) {
+        // Warm up, then alternate to even out frequency scaling.
+        time_ticks(shift_tick, new_slices, ticks / 10);
+        time_ticks(ring_tick, new_slices, ticks / 10);
+
+        double shift_ns = 0;
+        double ring_ns = 0;
+
+        for (int round = 0; round < 4; ++round) {
+            shift_ns += time_ticks(shift_tick, new_slices, ticks / 4);
+            ring_ns += time_ticks(ring_tick, new_slices, ticks / 4);
+        }
+        printf("%-7zu %12.1f %12.1f\n", new_slices, shift_ns / 4, ring_ns / 4);
+    }
+    // Keeps the compiler from dropping the copies.
+    int checksum = 0;
+    for (auto feature : input)
+        checksum += feature;
+    printf("checksum %d\n", checksum);
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Checks FeatureExtractor::snapshot() and restore(): an extractor restored from a
+// snapshot taken mid-stream must produce the same features, bit for bit, as one that
+// streamed without interruption, and malformed snapshots must be rejected without
+// touching the state. Build on the host against TFLM and run from the repo root:
+//
+//   g++ -std=c++14 -I include -I <tflite-micro> tools/check_feature_snapshot.cpp
+//       src/features_generator.cpp src/features_quantizer.cpp src/frontend_config.cpp
+//       src/frontend_fft.cpp <tflite-micro library> -o check_feature_snapshot
+//   ./check_feature_snapshot
+//
+// The audio is tones in noise with a level that changes over time, so that the noise
+// estimates and the PCAN gains keep adapting. Snapshots are taken at several points,
+// on and off slice boundaries. Exits with 1 on any failed check.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#include "audio_source.h"
+#include "features_generator.h"
+#include "model_settings.h"
+
+namespace {
+
+constexpr size_t audio_seconds = 6;
+
+std::vector<int16_t> make_audio(size_t samples)
+{
+    std::vector<int16_t> audio(samples);
+    uint32_t seed = 1;
+
+    for (size_t i = 0; i < samples; ++i) {
+        seed = seed * 1664525 + 1013904223;
+        const double t = static_cast<double>(i) / AUDIO_SAMPLE_FREQUENCY;
+        const double level = 0.55 + 0.45 * sin(2 * M_PI * t / 3);
+        const double tones = 4000 * sin(2 * M_PI * 500 * t) + 2000 * sin(2 * M_PI * 2300 * t) * (t > 2 && t < 4);
+        audio[i] = static_cast<int16_t>(level * (tones + static_cast<int16_t>(seed >> 16) / 8));
+    }
+    return audio;
+}
+
+// Streams audio in blocks like the capture path delivers it, appends the slices.
+bool stream(FeatureExtractor &extractor, const int16_t *audio, size_t count, std::vector<int8_t> &features)
+{
+    int8_t slices[2 * FEATURE_SLICE_SIZE];
+
+    for (size_t offset = 0; offset < count; offset += AUDIO_BLOCK_SAMPLES) {
+        const size_t block = std::min(AUDIO_BLOCK_SAMPLES, count - offset);
+        size_t num_slices, num_samples_read;
+
+        if (extractor.stream(audio + offset, block, slices, 2, &num_slices, &num_samples_read) != kTfLiteOk ||
+            num_samples_read != block)
+            return false;
+        features.insert(features.end(), slices, slices + num_slices * FEATURE_SLICE_SIZE);
+    }
+    return true;
+}
+
+int failures = 0;
+
+void check(bool ok, const char *what)
+{
+    printf("%-4s %s\n", ok ? "ok" : "FAIL", what);
+    failures += !ok;
+}
+
+// Streams up to split, snapshots, restores into a fresh extractor which streams the
+// rest, and compares with the uninterrupted features.
+void check_round_trip(const std::vector<int16_t> &audio, const std::vector<int8_t> &reference, size_t split)
+{
+    FeatureExtractor before;
+    FeatureExtractor after;
+    std::vector<int8_t> features;
+    uint8_t snapshot[FEATURE_SNAPSHOT_SIZE];
+    char what[96];
+
+    snprintf(what, sizeof(what), "round trip at sample %zu (%zu into a stride)", split, split % FEATURE_SLICE_STRIDE_SAMPLES);
+
+    if (before.init() != kTfLiteOk || after.init() != kTfLiteOk || !stream(before, audio.data(), split, features)) {
+        check(false, what);
+        return;
+    }
+    const size_t size = before.snapshot(snapshot, sizeof(snapshot));
+
+    if (!size || after.restore(snapshot, size) != kTfLiteOk ||
+        !stream(after, audio.data() + split, audio.size() - split, features)) {
+        check(false, what);
+        return;
+    }
+    check(features == reference, what);
+}
+
+// Restoring the snapshot, modified by corrupt, must fail and leave the state alone.
+template<class Corrupt>
+void check_rejected(const uint8_t *snapshot, size_t size, const char *what, Corrupt corrupt)
+{
+    FeatureExtractor extractor;
+    uint8_t blob[FEATURE_SNAPSHOT_SIZE];
+    uint8_t before[FEATURE_SNAPSHOT_SIZE];
+    uint8_t after[FEATURE_SNAPSHOT_SIZE];
+
+    memcpy(blob, snapshot, size);
+    const size_t blob_size = corrupt(blob, size);
+
+    if (extractor.init() != kTfLiteOk) {
+        check(false, what);
+        return;
+    }
+    const size_t before_size = extractor.snapshot(before, sizeof(before));
+    const bool rejected = extractor.restore(blob, blob_size) != kTfLiteOk;
+    const size_t after_size = extractor.snapshot(after, sizeof(after));
+
+    check(rejected && before_size == after_size && !memcmp(before, after, before_size), what);
+}
+
+}
+
+int main()
+{
+    const std::vector<int16_t> audio = make_audio(audio_seconds * AUDIO_SAMPLE_FREQUENCY);
+    std::vector<int8_t> reference;
+    FeatureExtractor extractor;
+
+    if (extractor.init() != kTfLiteOk || !stream(extractor, audio.data(), audio.size(), reference)) {
+        fprintf(stderr, "FeatureExtractor failed\n");
+        return 1;
+    }
+    printf("%zu s of audio, %zu slices\n", audio_seconds, reference.size() / FEATURE_SLICE_SIZE);
+
+    // Before the first window is full, on a stride, and in the middle of one.
+    for (size_t split : {size_t(123), size_t(100 * FEATURE_SLICE_STRIDE_SAMPLES),
+            size_t(150 * FEATURE_SLICE_STRIDE_SAMPLES + 77), audio.size() / 2 + 1})
+        check_round_trip(audio, reference, split);
+
+    // A snapshot with a full window, the largest there is.
+    FeatureExtractor source;
+    std::vector<int8_t> features;
+    uint8_t snapshot[FEATURE_SNAPSHOT_SIZE];
+
+    if (source.init() != kTfLiteOk || !stream(source, audio.data(), FEATURE_SLICE_DURATION_SAMPLES - 1, features)) {
+        fprintf(stderr, "FeatureExtractor failed\n");
+        return 1;
+    }
+    const size_t size = source.snapshot(snapshot, sizeof(snapshot));
+
+    check(size && size <= FEATURE_SNAPSHOT_SIZE, "snapshot fits FEATURE_SNAPSHOT_SIZE");
+    check(!source.snapshot(snapshot, size - 1), "snapshot into a short buffer is refused");
+
+    check_rejected(snapshot, size, "bad magic", [](uint8_t *blob, size_t size) {
+        blob[0] = 'X';
+        return size;
+    });
+    check_rejected(snapshot, size, "other version", [](uint8_t *blob, size_t size) {
+        blob[4] += 1;
+        return size;
+    });
+    check_rejected(snapshot, size, "other channel count", [](uint8_t *blob, size_t size) {
+        blob[6] += 1;
+        return size;
+    });
+    check_rejected(snapshot, size, "other window size", [](uint8_t *blob, size_t size) {
+        blob[8] += 1;
+        return size;
+    });
+    check_rejected(snapshot, size, "window fill beyond the window", [](uint8_t *blob, size_t size) {
+        blob[12] = 0xff;
+        blob[13] = 0xff;
+        return size;
+    });
+    check_rejected(snapshot, size, "truncated", [](uint8_t*, size_t size) {
+        return size - 1;
+    });
+    check_rejected(snapshot, size, "header only", [](uint8_t*, size_t) {
+        return FEATURE_SNAPSHOT_HEADER_SIZE - 1;
+    });
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
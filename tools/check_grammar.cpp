@@ -0,0 +1,106 @@
+// Feeds scripted keyword sequences through the grammar and the hold of VoiceCmd, for the
+// hold of every recognizer profile, and checks which commands get shown. Build on the
+// host against the TFLM headers and run from the repo root:
+//
+//   g++ -std=c++14 -I include -I <tflite-micro> tools/check_grammar.cpp src/grammar.cpp -o check_grammar
+//   ./check_grammar
+//
+// The recognizer's output is scripted: a new word at the given times, silence on every
+// other tick. Exits with 1 on any mismatch.
+
+#include <cstdio>
+#include <vector>
+
+#include "grammar.h"
+#include "recognizer.h"
+
+namespace {
+
+constexpr auto grammar_table = build_grammar<8>(GRAMMAR_RULES);
+static_assert(grammar_table.valid, "");
+
+// Model runs of the device, every 200 ms.
+constexpr int64_t tick = ms_to_samples(200);
+
+struct Word {
+    int64_t ms;
+    uint8_t label;
+};
+
+struct Case {
+    const char *name;
+    std::vector<Word> words;
+    std::vector<uint8_t> shown;
+};
+
+// Starts well after the hold of any profile, which counts from a last command at 0.
+const Case cases[] = {
+    {"on off inside the hold",          {{5000, ON}, {5600, OFF}},      {ON, ON_OFF}},
+    {"off on inside the hold",          {{5000, OFF}, {5400, ON}},      {OFF, OFF_ON}},
+    {"on off after the hold",           {{5000, ON}, {6800, OFF}},      {ON, ON_OFF}},
+    {"on off beyond max_gap",           {{5000, ON}, {7400, OFF}},      {ON, OFF}},
+    {"on on inside the hold",           {{5000, ON}, {5600, ON}},       {ON}},
+    {"on off off inside the hold",      {{5000, ON}, {5400, OFF}, {5800, OFF}}, {ON, ON_OFF}},
+};
+
+// Mirrors VoiceCmd::respond(): what is shown and when the last command was.
+std::vector<uint8_t> run(const Case &test, int64_t hold)
+{
+    Grammar grammar(grammar_table);
+    std::vector<uint8_t> shown;
+    int64_t last_shown = 0;
+    size_t next_word = 0;
+    const int64_t end = ms_to_samples(test.words.back().ms) + ms_to_samples(3000);
+
+    for (int64_t sample = tick; sample <= end; sample += tick) {
+        Command cmd;
+
+        if (next_word < test.words.size() && ms_to_samples(test.words[next_word].ms) <= sample)
+            cmd = {test.words[next_word++].label, 220, true};
+        cmd = grammar.process(cmd, sample);
+
+        if (shown_after_hold(cmd, sample, last_shown, hold)) {
+            if (cmd.found_command != SILENCE) {
+                shown.push_back(cmd.found_command);
+                last_shown = sample;
+            }
+        }
+        if (last_shown && last_shown < sample - hold)
+            last_shown = 0;
+    }
+    return shown;
+}
+
+void print_commands(const char *what, const std::vector<uint8_t> &commands)
+{
+    printf("  %s:", what);
+    for (auto cmd : commands)
+        printf(" %s,", command_name(cmd));
+    printf("\n");
+}
+
+}
+
+int main()
+{
+    int failures = 0;
+
+    for (size_t profile = 0; profile < N_PROFILES; ++profile) {
+        const int64_t hold = RECOGNIZER_PROFILES[profile].hold;
+
+        for (const Case &test : cases) {
+            const std::vector<uint8_t> shown = run(test, hold);
+            const bool ok = shown == test.shown;
+
+            printf("%-4s profile %zu, hold %ld ms: %s\n", ok ? "ok" : "FAIL", profile,
+                static_cast<long>(samples_to_ms(hold)), test.name);
+            if (!ok) {
+                print_commands("expected", test.shown);
+                print_commands("shown", shown);
+                ++failures;
+            }
+        }
+    }
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,154 @@
+// Runs the same audio through the frontend with the CMSIS-DSP FFT backend and with
+// kissfft, compares the spectra and the features they produce, and times both. Build
+// on the host against TFLM and CMSIS-DSP, whose plain C code compiles for any target,
+// and run from the repo root:
+//
+//   g++ -std=c++14 -O2 -D VOICE_CMD_FFT_CMSIS -I include -I <tflite-micro> -I <CMSIS-DSP>/Include
+//       -I <CMSIS>/Core/Include tools/compare_fft.cpp src/frontend_fft.cpp src/frontend_config.cpp
+//       src/features_quantizer.cpp <CMSIS-DSP TransformFunctions and CommonTables>
+//       <tflite-micro library> -o compare_fft
+//   ./compare_fft [seconds]
+//
+// frontend_process_samples() then runs arm_rfft_q15(), FrontendProcessSamples() is the
+// library's kissfft path. The audio is tones in noise at levels from near silence to
+// full scale, so the input scaling of the FFT is exercised across its range.
+// Spectra are compared as the energy of the filterbank bins, which both paths leave in
+// the FFT output buffer. Host timings, compare the paths with each other.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "features_quantizer.h"
+#include "frontend_config.h"
+#include "frontend_fft.h"
+#include "model_settings.h"
+
+#if !defined(VOICE_CMD_FFT_CMSIS)
+#error "Build with -D VOICE_CMD_FFT_CMSIS, or both paths are kissfft"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<int16_t> make_audio(size_t samples)
+{
+    std::vector<int16_t> audio(samples);
+    uint32_t seed = 1;
+
+    for (size_t i = 0; i < samples; ++i) {
+        seed = seed * 1664525 + 1013904223;
+        const double t = static_cast<double>(i) / AUDIO_SAMPLE_FREQUENCY;
+        // The level sweeps over 60 dB every 4 s.
+        const double level = pow(10, -3 * (0.5 + 0.5 * sin(2 * M_PI * t / 4)));
+        const double signal = 0.5 * sin(2 * M_PI * 300 * t) + 0.3 * sin(2 * M_PI * 2100 * t) +
+            0.2 * static_cast<int16_t>(seed >> 16) / 32768.0;
+        audio[i] = static_cast<int16_t>(32767 * level * signal);
+    }
+    return audio;
+}
+
+struct Path {
+    FrontendFft fft;
+    FrontendState state = {};
+    std::vector<int32_t> energy;
+    std::vector<int8_t> features;
+    double seconds = 0;
+};
+
+template<class Process>
+bool run(Path &path, const std::vector<int16_t> &audio, Process process)
+{
+    if (!populate_frontend_state(&path.state) || init_frontend_fft(path.fft, path.state) != kTfLiteOk)
+        return false;
+
+    const int32_t *energy = reinterpret_cast<const int32_t*>(path.state.fft.output);
+    const int start = path.state.filterbank.start_index;
+    const int end = path.state.filterbank.end_index;
+    int8_t slice[FEATURE_SLICE_SIZE];
+    size_t offset = 0;
+
+    while (offset < audio.size()) {
+        size_t read = 0;
+        const auto begin = Clock::now();
+        const FrontendOutput output = process(path.fft, &path.state, &audio[offset], audio.size() - offset, &read);
+        path.seconds += std::chrono::duration<double>(Clock::now() - begin).count();
+
+        offset += read;
+        if (!output.values)
+            continue;
+        if (output.size != FEATURE_SLICE_SIZE)
+            return false;
+        path.energy.insert(path.energy.end(), energy + start, energy + end);
+        quantize_features(output.values, output.size, slice);
+        path.features.insert(path.features.end(), slice, slice + FEATURE_SLICE_SIZE);
+    }
+    free_frontend_state(&path.state);
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    const double seconds = argc > 1 ? strtod(argv[1], nullptr) : 60;
+
+    if (argc > 2 || seconds <= 0) {
+        fprintf(stderr, "Usage: %s [seconds]\n", argv[0]);
+        return 1;
+    }
+    const std::vector<int16_t> audio = make_audio(seconds * AUDIO_SAMPLE_FREQUENCY);
+    Path cmsis;
+    Path kiss;
+
+    const auto kissfft = [](FrontendFft&, FrontendState *state, const int16_t *samples, size_t num_samples, size_t *num_samples_read) {
+        return FrontendProcessSamples(state, samples, num_samples, num_samples_read);
+    };
+
+    if (!run(cmsis, audio, frontend_process_samples) || !run(kiss, audio, kissfft)) {
+        fprintf(stderr, "Frontend setup or processing failed\n");
+        return 1;
+    }
+    if (cmsis.features.empty() || cmsis.features.size() != kiss.features.size()) {
+        fprintf(stderr, "Paths produced no or a different number of slices\n");
+        return 1;
+    }
+    // Energy: worst bin relative to the slice's peak, since quiet bins carry no weight.
+    const size_t bins = cmsis.energy.size() / (cmsis.features.size() / FEATURE_SLICE_SIZE);
+    double worst_energy = 0;
+    double sum_energy = 0;
+
+    for (size_t slice = 0; slice < cmsis.energy.size(); slice += bins) {
+        int64_t peak = 1;
+        int64_t diff = 0;
+        for (size_t i = slice; i < slice + bins; ++i) {
+            peak = std::max<int64_t>(peak, kiss.energy[i]);
+            diff = std::max<int64_t>(diff, std::llabs(static_cast<int64_t>(cmsis.energy[i]) - kiss.energy[i]));
+        }
+        worst_energy = std::max(worst_energy, static_cast<double>(diff) / peak);
+        sum_energy += static_cast<double>(diff) / peak;
+    }
+    // Features: what the model sees.
+    size_t differing = 0;
+    int worst_feature = 0;
+
+    for (size_t i = 0; i < cmsis.features.size(); ++i) {
+        const int diff = std::abs(cmsis.features[i] - kiss.features[i]);
+        differing += diff != 0;
+        worst_feature = std::max(worst_feature, diff);
+    }
+    const size_t slices = cmsis.features.size() / FEATURE_SLICE_SIZE;
+
+    printf("%.0f s of audio, %zu slices, %zu filterbank bins\n", seconds, slices, bins);
+    printf("energy, max bin error / slice peak:  worst %.2e, mean %.2e\n", worst_energy, sum_energy / slices);
+    printf("int8 features differing:             %zu of %zu (%.2f%%), worst by %d\n",
+        differing, cmsis.features.size(), 100.0 * differing / cmsis.features.size(), worst_feature);
+    printf("%-8s %12s\n", "path", "us/slice");
+    printf("%-8s %12.2f\n", "cmsis", 1e6 * cmsis.seconds / slices);
+    printf("%-8s %12.2f\n", "kissfft", 1e6 * kiss.seconds / slices);
+    return 0;
+}
@@ -0,0 +1,62 @@
+// Replays recorded model output (see trace.h) through every smoothing mode of the
+// recognizer, with and without early trigger, and reports detection latency (from
+// the end of the word where annotated) and false accepts side by side. Build on
+// the host against the TFLM headers and run with one or more traces, or stdin:
+//
+//   g++ -std=c++14 -I include -I <tflite-micro> tools/eval_recognizer.cpp src/recognizer.cpp
+//   ./a.out trace_0.txt trace_1.txt
+
+#include <cstdio>
+
+#include "trace.h"
+
+int main(int argc, char **argv)
+{
+    static constexpr struct {
+        Smoothing smoothing;
+        const char *name;
+    } modes[] = {
+        {Smoothing::AVERAGE,    "average"},
+        {Smoothing::EWMA,       "ewma"},
+        {Smoothing::HMM,        "hmm"},
+    };
+    std::vector<Trace> traces;
+
+    for (int i = 1; i < argc || (i == 1 && argc == 1); ++i) {
+        FILE *file = argc > 1 ? fopen(argv[i], "r") : stdin;
+
+        if (!file) {
+            fprintf(stderr, "Can't open %s\n", argv[i]);
+            return 1;
+        }
+        traces.emplace_back();
+        const bool loaded = load_trace(file, traces.back());
+        if (file != stdin)
+            fclose(file);
+        if (!loaded)
+            return 1;
+    }
+
+    printf("%-8s %6s %8s %8s %12s %12s %8s %10s\n", 
+        "mode", "early", "keywords", "hits", "latency ms", "max ms", "false", "false/h");
+
+    for (const auto &mode : modes) {
+        for (bool early : {false, true}) {
+            Evaluation total;
+
+            // Every trace is a separate recording, so each gets a fresh recognizer.
+            for (const auto &trace : traces) {
+                RecognizerConfig config = RECOGNIZER_PROFILES[BALANCED];
+                config.smoothing = mode.smoothing;
+                config.early_trigger = early;
+
+                Recognizer recognizer(config);
+                total += evaluate(recognizer, trace);
+            }
+            printf("%-8s %6s %8zu %8zu %12.1f %12ld %8zu %10.2f\n", 
+                mode.name, early ? "yes" : "no", total.keywords, total.hits, total.mean_latency_ms(), 
+                static_cast<long>(samples_to_ms(total.latency_max)), total.false_accepts, total.false_accepts_per_hour());
+        }
+    }
+    return 0;
+}
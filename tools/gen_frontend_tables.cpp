@@ -0,0 +1,102 @@
+// Runs FrontendPopulateState() for FRONTEND_PARAMS on the host and prints the
+// constant tables it computes as a header, so that the device keeps them in flash
+// instead of computing them on the heap at every boot. Build against the TFLM
+// microfrontend sources (lib/*.c, lib/*.cc and kissfft) and run from the repo root:
+//
+//   g++ -std=c++14 -I include -I <tflite-micro> -I <kissfft>
+//       tools/gen_frontend_tables.cpp <microfrontend sources> -o gen_frontend_tables
+//   ./gen_frontend_tables > include/frontend_tables.h
+//
+// The PlatformIO build does this with tools/generate_headers.py whenever the header is
+// missing or older than FRONTEND_PARAMS. By hand, rerun after changing FRONTEND_PARAMS,
+// the firmware refuses to build with stale tables.
+
+#include <cstdio>
+#include <cinttypes>
+
+#include <tensorflow/lite/experimental/microfrontend/lib/frontend.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/frontend_util.h>
+#include <tensorflow/lite/experimental/microfrontend/lib/pcan_gain_control_util.h>
+
+#include "frontend_config.h"
+
+namespace {
+
+void print_array(const char *name, const int16_t *data, size_t size)
+{
+    printf("const int16_t %s[%zu] = {", name, size);
+    for (size_t i = 0; i < size; ++i)
+        printf("%s%d,", i % 12 ? " " : "\n    ", data[i]);
+    printf("\n};\n");
+}
+
+}
+
+int main()
+{
+    const FrontendParams &p = FRONTEND_PARAMS;
+    const FrontendConfig config = make_frontend_config();
+    FrontendState state = {};
+
+    if (!FrontendPopulateState(&config, &state, p.sample_rate)) {
+        fprintf(stderr, "FrontendPopulateState() failed\n");
+        return 1;
+    }
+    const FilterbankState &fb = state.filterbank;
+    const NoiseReductionState &nr = state.noise_reduction;
+    const PcanGainControlState &pcan = state.pcan_gain_control;
+
+    size_t weight_count = 0;
+    for (int i = 0; i <= fb.num_channels; ++i) {
+        const size_t end = fb.channel_weight_starts[i] + fb.channel_widths[i];
+        if (end > weight_count)
+            weight_count = end;
+    }
+
+    printf("// Generated by tools/gen_frontend_tables.cpp, do not edit.\n\n");
+    printf("#include \"frontend_config.h\"\n\n");
+    printf("#pragma once\n\n");
+    printf("namespace frontend_tables {\n\n");
+    printf("constexpr FrontendParams params = {\n");
+    printf("    %zu,\n    %zu,\n    %zu,\n    %d,\n", p.sample_rate, p.window_size_ms, p.window_step_ms, p.num_channels);
+    printf("    %#.9gf,\n    %#.9gf,\n", p.lower_band_limit, p.upper_band_limit);
+    printf("    %d,\n    %#.9gf,\n    %#.9gf,\n    %#.9gf,\n", p.smoothing_bits, p.even_smoothing, p.odd_smoothing, p.min_signal_remaining);
+    printf("    %d,\n    %#.9gf,\n    %#.9gf,\n    %d,\n", p.enable_pcan, p.pcan_strength, p.pcan_offset, p.pcan_gain_bits);
+    printf("    %d,\n    %d,\n", p.enable_log, p.log_scale_shift);
+    printf("};\n\n");
+
+    printf("constexpr size_t window_size = %zu;\n", state.window.size);
+    printf("constexpr size_t window_step = %zu;\n", state.window.step);
+    print_array("window_coefficients", state.window.coefficients, state.window.size);
+    printf("\n");
+
+    printf("constexpr int num_channels = %d;\n", fb.num_channels);
+    printf("constexpr int filterbank_start_index = %d;\n", fb.start_index);
+    printf("constexpr int filterbank_end_index = %d;\n", fb.end_index);
+    print_array("channel_frequency_starts", fb.channel_frequency_starts, fb.num_channels + 1);
+    print_array("channel_weight_starts", fb.channel_weight_starts, fb.num_channels + 1);
+    print_array("channel_widths", fb.channel_widths, fb.num_channels + 1);
+    print_array("filterbank_weights", fb.weights, weight_count);
+    print_array("filterbank_unweights", fb.unweights, weight_count);
+    printf("\n");
+
+    printf("constexpr int noise_smoothing_bits = %d;\n", nr.smoothing_bits);
+    printf("constexpr uint16_t noise_even_smoothing = %u;\n", nr.even_smoothing);
+    printf("constexpr uint16_t noise_odd_smoothing = %u;\n", nr.odd_smoothing);
+    printf("constexpr uint16_t noise_min_signal_remaining = %u;\n\n", nr.min_signal_remaining);
+
+    printf("constexpr int pcan_enable = %d;\n", pcan.enable_pcan);
+    printf("constexpr int32_t pcan_snr_shift = %" PRId32 ";\n", pcan.snr_shift);
+    if (pcan.enable_pcan)
+        print_array("pcan_gain_lut", pcan.gain_lut, kWideDynamicFunctionLUTSize);
+    else
+        printf("constexpr const int16_t *pcan_gain_lut = nullptr;\n");
+    printf("\n");
+
+    printf("constexpr int log_enable = %d;\n", state.log_scale.enable_log);
+    printf("constexpr int log_scale_shift = %d;\n\n", state.log_scale.scale_shift);
+    printf("}\n");
+
+    FrontendFreeStateContents(&state);
+    return 0;
+}
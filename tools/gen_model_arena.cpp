@@ -0,0 +1,64 @@
+// Allocates g_model's tensors on the host in an oversized arena and prints how much
+// of it the interpreter used as a header, which sizes the device's tensor arena. Build
+// against TFLM and run from the repo root:
+//
+//   g++ -std=c++14 -m32 -I include -I <tflite-micro> -I <flatbuffers> tools/gen_model_arena.cpp
+//       <tflite-micro library> -o gen_model_arena
+//   ./gen_model_arena > include/model_arena.h
+//
+// -m32 matches the device's pointer size. Without it the interpreter's structs are
+// bigger than on the device, which overestimates the arena but is still safe. The
+// PlatformIO build does this with tools/generate_headers.py whenever the header is
+// missing or older than the model. By hand, rerun after changing the model, the
+// firmware refuses to build with a header for a model of another size.
+
+#include <cstdio>
+
+#include <tensorflow/lite/micro/micro_error_reporter.h>
+#include <tensorflow/lite/micro/micro_interpreter.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+#include <tensorflow/lite/version.h>
+
+#include "model.h"
+
+namespace {
+
+// Far more than any model that fits the device needs.
+constexpr size_t probe_arena_size = 256 * 1024;
+
+}
+
+int main()
+{
+    static tflite::MicroErrorReporter reporter;
+    static uint8_t tensor_arena[probe_arena_size];
+    static tflite::MicroMutableOpResolver<4> resolver(&reporter);
+
+    const tflite::Model *model = tflite::GetModel(g_model);
+
+    if (model->version() != TFLITE_SCHEMA_VERSION) {
+        fprintf(stderr, "Unsupported model schema version\n");
+        return 1;
+    }
+    // Same ops as the device, the kernels' Prepare() claims scratch from the arena too.
+    resolver.AddDepthwiseConv2D();
+    resolver.AddFullyConnected();
+    resolver.AddSoftmax();
+    resolver.AddReshape();
+
+    tflite::MicroInterpreter interpreter(model, resolver, tensor_arena, probe_arena_size, &reporter);
+
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+        fprintf(stderr, "AllocateTensors() failed\n");
+        return 1;
+    }
+    printf("// Generated by tools/gen_model_arena.cpp, don't edit.\n\n");
+    printf("#include <cstddef>\n\n");
+    printf("#pragma once\n\n");
+    printf("namespace model_arena {\n\n");
+    printf("constexpr size_t model_len = %u;\n", g_model_len);
+    printf("constexpr size_t used_bytes = %zu;\n\n", interpreter.arena_used_bytes());
+    printf("}\n");
+    return 0;
+}
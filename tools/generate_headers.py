@@ -0,0 +1,150 @@
+# PlatformIO pre-build script: builds the host generators in tools/ against the
+# TensorFlow Lite library found in lib_extra_dirs and writes the headers they print
+# into include/, whenever a header is missing or older than what it is generated from:
+#   frontend_tables.h  tools/gen_frontend_tables.cpp, from FRONTEND_PARAMS.
+#   model_arena.h      tools/gen_model_arena.cpp, from the model in model.h.
+# Without a host compiler or the library the build goes on without the headers, on
+# the fallbacks the firmware has for them. Set HOST_CC and HOST_CXX to pick the host
+# compilers, gcc and g++ by default.
+
+Import("env")
+
+import glob
+import os
+import subprocess
+
+project_dir = env.subst("$PROJECT_DIR")
+include_dir = os.path.join(project_dir, "include")
+work_dir = os.path.join(env.subst("$PROJECT_BUILD_DIR"), "host_generators")
+host_cc = os.environ.get("HOST_CC", "gcc")
+host_cxx = os.environ.get("HOST_CXX", "g++")
+
+
+def project_path(*parts):
+    return os.path.join(project_dir, *parts)
+
+
+def find_tflite():
+    """Source root of the Arduino TensorFlow Lite library, the directory holding tensorflow/."""
+    dirs = env.GetProjectOption("lib_extra_dirs", [])
+    if isinstance(dirs, str):
+        dirs = dirs.split()
+    for lib_dir in dirs:
+        lib_dir = os.path.expanduser(lib_dir)
+        for root in glob.glob(os.path.join(lib_dir, "*", "src")) + [lib_dir]:
+            if os.path.isfile(os.path.join(root, "tensorflow", "lite", "version.h")):
+                return root
+    return None
+
+
+def microfrontend_sources(tflite):
+    lib = os.path.join(tflite, "tensorflow", "lite", "experimental", "microfrontend", "lib")
+    return [path for path in glob.glob(os.path.join(lib, "*.c")) + glob.glob(os.path.join(lib, "*.cc"))
+            if not path.endswith(("_test.cc", "_io.c"))]
+
+
+def tflite_sources(tflite):
+    """Interpreter, kernels and their dependencies, without device specific code."""
+    sources = []
+    for root, _, files in os.walk(os.path.join(tflite, "tensorflow", "lite")):
+        rel = os.path.relpath(root, tflite).replace(os.sep, "/")
+        if any(part in rel for part in ("microfrontend", "arduino", "cmsis", "examples", "testing")):
+            continue
+        sources += [os.path.join(root, name) for name in files
+                    if name.endswith((".c", ".cc", ".cpp")) and not name.endswith(("_test.cc", "_test.cpp"))]
+
+    # The library's DebugLog() writes to Serial, log to stderr instead.
+    if not any(os.path.basename(path).startswith("debug_log.") for path in sources):
+        debug_log = os.path.join(work_dir, "debug_log.cc")
+        if not os.path.isdir(work_dir):
+            os.makedirs(work_dir)
+        with open(debug_log, "w") as out:
+            out.write('#include <cstdio>\nextern "C" void DebugLog(const char *s) { fputs(s, stderr); }\n')
+        sources.append(debug_log)
+    return sources
+
+
+def tflite_defines():
+    """TF_LITE_* macros of the firmware build, they change the size of the interpreter's structs."""
+    defines = []
+    for define in env.get("CPPDEFINES", []):
+        name, value = (define[0], define[1]) if isinstance(define, (list, tuple)) else (define, None)
+        if str(name).startswith("TF_LITE"):
+            defines.append("-D%s" % name if value is None else "-D%s=%s" % (name, value))
+    return defines
+
+
+def stale(header, inputs):
+    if not os.path.isfile(header):
+        return True
+    built = os.path.getmtime(header)
+    return any(os.path.getmtime(path) > built for path in inputs)
+
+
+def compile_generator(name, main, sources, tflite, flags):
+    """Compiles main and the library sources for the host, returns the executable or None."""
+    out_dir = os.path.join(work_dir, name)
+    if not os.path.isdir(out_dir):
+        os.makedirs(out_dir)
+
+    includes = ["-I", project_path("include"), "-I", tflite]
+    objects = []
+    for index, source in enumerate(sources):
+        compiler = host_cc if source.endswith(".c") else host_cxx
+        std = "-std=c11" if source.endswith(".c") else "-std=c++14"
+        obj = os.path.join(out_dir, "%d_%s.o" % (index, os.path.basename(source)))
+        if subprocess.call([compiler, std, "-O1", "-w"] + flags + includes + ["-c", source, "-o", obj]):
+            return None
+        objects.append(obj)
+
+    exe = os.path.join(out_dir, name)
+    if subprocess.call([host_cxx, "-std=c++14"] + flags + includes + [main] + objects + ["-o", exe]):
+        return None
+    return exe
+
+
+def generate(name, header, inputs, sources, tflite, flag_sets=([],)):
+    header = project_path("include", header)
+    inputs = [project_path(*path.split("/")) for path in inputs]
+
+    if not stale(header, inputs):
+        return
+    print("Generating %s" % os.path.relpath(header, project_dir))
+
+    exe = None
+    for flags in flag_sets:
+        exe = compile_generator(name, project_path("tools", name + ".cpp"), sources, tflite, flags)
+        if exe:
+            break
+    output = None
+    if exe:
+        try:
+            output = subprocess.check_output([exe], cwd=project_dir)
+        except (OSError, subprocess.CalledProcessError):
+            output = None
+    if not output:
+        # A stale header would only fail the build, the fallback is better.
+        if os.path.isfile(header):
+            os.remove(header)
+        print("Warning: could not generate %s, building without it" % os.path.relpath(header, project_dir))
+        return
+    with open(header, "wb") as out:
+        out.write(output)
+
+
+tflite = find_tflite()
+
+if not tflite:
+    print("Warning: TensorFlow Lite library not found in lib_extra_dirs, building without generated headers")
+else:
+    generate(
+        "gen_frontend_tables", "frontend_tables.h",
+        ["tools/gen_frontend_tables.cpp", "include/frontend_config.h", "include/model_settings.h"],
+        microfrontend_sources(tflite), tflite)
+    # -m32 matches the device's pointer size, without 32-bit host libraries the arena is
+    # measured with bigger structs, which overestimates it.
+    generate(
+        "gen_model_arena", "model_arena.h",
+        ["tools/gen_model_arena.cpp", "include/model.h"],
+        tflite_sources(tflite), tflite,
+        (["-m32"] + tflite_defines(), tflite_defines()))
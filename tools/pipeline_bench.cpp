@@ -0,0 +1,225 @@
+// Replays audio in real time through the device pipeline and reports how long after
+// its audio was captured each recognizer result comes out, with a synthetic load
+// standing in for BLE events. Build on the host against TFLM and run from the repo root:
+//
+//   g++ -std=c++14 -pthread -I include -I <tflite-micro> -I <flatbuffers> tools/pipeline_bench.cpp
+//       src/pipeline.cpp src/recognizer.cpp src/grammar.cpp src/audio_provider.cpp
+//       src/audio_source_file.cpp src/voice_activity.cpp src/feature_provider.cpp
+//       src/features_generator.cpp src/features_quantizer.cpp src/frontend_config.cpp
+//       src/frontend_fft.cpp src/stage_timer.cpp <tflite-micro library> -o pipeline_bench
+//   taskset -c 0 ./pipeline_bench [-m serial|pipelined] [-l load_ms] [-p period_ms] audio.wav
+//
+// serial runs features, the model and the load one after another on one thread, like
+// a single event queue. pipelined runs them on the feature, inference and load threads
+// of the device. std::threads have no priorities, so the host scheduler only
+// approximates the device. Pin to one core to keep the stages competing for the CPU.
+// The stage timings are printed at the end.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <tensorflow/lite/micro/micro_error_reporter.h>
+#include <tensorflow/lite/micro/micro_interpreter.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+#include <tensorflow/lite/version.h>
+
+#include "audio_provider.h"
+#include "audio_source_file.h"
+#include "model.h"
+#include "pipeline.h"
+#include "thread_signal.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int64_t cadence = 10 * FEATURE_SLICE_STRIDE_SAMPLES;
+constexpr auto grammar_table = build_grammar<8>(GRAMMAR_RULES);
+static_assert(grammar_table.valid, "");
+
+ThreadSignal audio_signal;
+ThreadSignal spectrogram_signal;
+std::atomic<bool> running{true};
+
+Clock::time_point start_time;
+std::mutex latencies_mutex;
+std::vector<double> latencies;  // Milliseconds from the audio to the result.
+
+void stride_ready(void*)
+{
+    audio_signal.raise();
+}
+
+// Keeps the CPU busy, like a BLE event would.
+void busy(std::chrono::microseconds duration)
+{
+    const auto end = Clock::now() + duration;
+    while (Clock::now() < end) {}
+}
+
+void record(int64_t sample)
+{
+    const auto captured = start_time + std::chrono::microseconds(sample * 1000000 / AUDIO_SAMPLE_FREQUENCY);
+    const double latency = std::chrono::duration<double, std::milli>(Clock::now() - captured).count();
+
+    std::lock_guard<std::mutex> lock(latencies_mutex);
+    latencies.push_back(latency);
+}
+
+bool infer(InferenceStage &inference)
+{
+    Command cmd;
+    int64_t sample;
+    TfLiteStatus status;
+
+    if (inference.process(cmd, sample, status))
+        record(sample);
+    return status == kTfLiteOk;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    bool pipelined = true;
+    long load_ms = 20;
+    long period_ms = 100;
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (!strcmp(argv[arg], "-m"))
+            pipelined = strcmp(argv[arg + 1], "serial");
+        else if (!strcmp(argv[arg], "-l"))
+            load_ms = strtol(argv[arg + 1], nullptr, 10);
+        else if (!strcmp(argv[arg], "-p"))
+            period_ms = strtol(argv[arg + 1], nullptr, 10);
+        else
+            break;
+    }
+    if (argc - arg != 1 || load_ms < 0 || period_ms <= 0) {
+        fprintf(stderr, "Usage: %s [-m serial|pipelined] [-l load_ms] [-p period_ms] audio.wav\n", argv[0]);
+        return 1;
+    }
+    FILE *audio = fopen(argv[arg], "rb");
+
+    if (!audio) {
+        fprintf(stderr, "Can't open %s\n", argv[arg]);
+        return 1;
+    }
+    FileAudioSource source(audio, FileAudioSource::Format::WAV, FileAudioSource::Pacing::REAL_TIME);
+
+    static tflite::MicroErrorReporter reporter;
+    static uint8_t tensor_arena[TENSOR_ARENA_SIZE];
+    static tflite::MicroMutableOpResolver<4> resolver(&reporter);
+    static int8_t features[FEATURE_ELEMENT_COUNT];
+
+    const tflite::Model *model = tflite::GetModel(g_model);
+
+    if (model->version() != TFLITE_SCHEMA_VERSION) {
+        fprintf(stderr, "Unsupported model schema version\n");
+        return 1;
+    }
+    resolver.AddDepthwiseConv2D();
+    resolver.AddFullyConnected();
+    resolver.AddSoftmax();
+    resolver.AddReshape();
+
+    tflite::MicroInterpreter interpreter(model, resolver, tensor_arena, TENSOR_ARENA_SIZE, &reporter);
+
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+        fprintf(stderr, "AllocateTensors() failed\n");
+        return 1;
+    }
+    FeatureProvider provider(features);
+    SpectrogramExchange exchange;
+    Recognizer recognizer;
+    Grammar grammar(grammar_table);
+    FeatureStage feature_stage(provider, exchange, cadence);
+    InferenceStage inference_stage(interpreter, exchange, recognizer, grammar, samples_to_ms(cadence) * 1000);
+
+    init_stage_timer();
+    start_time = Clock::now();
+
+    if (init_micro_features() != kTfLiteOk || init_audio_recording(source) != kTfLiteOk) {
+        fprintf(stderr, "Frontend or audio initialization failed\n");
+        return 1;
+    }
+    const std::chrono::microseconds load(load_ms * 1000);
+    const std::chrono::milliseconds period(period_ms);
+    std::vector<std::thread> threads;
+
+    if (pipelined) {
+        threads.emplace_back([&] {
+            while (running) {
+                audio_signal.wait();
+                bool published = false;
+                if (feature_stage.process(published) == kTfLiteOk && published)
+                    spectrogram_signal.raise();
+            }
+            spectrogram_signal.raise();
+        });
+        threads.emplace_back([&] {
+            while (running) {
+                spectrogram_signal.wait();
+                if (!infer(inference_stage))
+                    running = false;
+            }
+        });
+        threads.emplace_back([&] {
+            for (auto next = Clock::now(); running; next += period) {
+                std::this_thread::sleep_until(next);
+                busy(load);
+            }
+        });
+    } else {
+        threads.emplace_back([&] {
+            auto next_load = Clock::now();
+            while (running) {
+                audio_signal.wait();
+                if (Clock::now() >= next_load) {
+                    busy(load);
+                    next_load += period;
+                }
+                bool published = false;
+                if (feature_stage.process(published) == kTfLiteOk && published && !infer(inference_stage))
+                    running = false;
+            }
+        });
+    }
+    set_audio_stride_handler(stride_ready, nullptr);
+
+    // This thread is the microphone.
+    while (running && !source.finished()) {
+        get_latest_audio_sample();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    set_audio_stride_handler(nullptr, nullptr);
+    running = false;
+    audio_signal.raise();
+    for (auto &thread : threads)
+        thread.join();
+
+    if (latencies.empty()) {
+        fprintf(stderr, "No results\n");
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    double sum = 0;
+    for (auto latency : latencies)
+        sum += latency;
+
+    printf("%s, load %ld ms every %ld ms: %zu results, latency mean %.1f ms, p99 %.1f ms, max %.1f ms\n",
+        pipelined ? "pipelined" : "serial", load_ms, period_ms, latencies.size(), sum / latencies.size(),
+        latencies[latencies.size() * 99 / 100], latencies.back());
+    print_stage_stats();
+    return 0;
+}
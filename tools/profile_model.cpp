@@ -0,0 +1,73 @@
+// Runs g_model on the host with the same per-op profiler as the device and prints
+// the same table, to find the layers worth optimizing. Timings are host timings,
+// compare shares between nodes rather than absolute numbers with the device.
+// Build against TFLM and run from the repo root:
+//
+//   g++ -std=c++14 -O2 -I include -I <tflite-micro> -I <flatbuffers> tools/profile_model.cpp
+//       src/op_profiler.cpp src/stage_timer.cpp <tflite-micro library> -o profile_model
+//   ./profile_model [invocations]
+//
+// The input is pseudo-random, run time doesn't depend on it for this graph.
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <tensorflow/lite/micro/micro_error_reporter.h>
+#include <tensorflow/lite/micro/micro_interpreter.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+#include <tensorflow/lite/version.h>
+
+#include "model.h"
+#include "model_settings.h"
+#include "op_profiler.h"
+#include "stage_timer.h"
+
+int main(int argc, char **argv)
+{
+    const long invocations = argc > 1 ? strtol(argv[1], nullptr, 10) : 100;
+
+    if (argc > 2 || invocations <= 0) {
+        fprintf(stderr, "Usage: %s [invocations]\n", argv[0]);
+        return 1;
+    }
+    static tflite::MicroErrorReporter reporter;
+    static uint8_t tensor_arena[TENSOR_ARENA_SIZE];
+    static tflite::MicroMutableOpResolver<4> resolver(&reporter);
+    static OpProfiler profiler;
+
+    const tflite::Model *model = tflite::GetModel(g_model);
+
+    if (model->version() != TFLITE_SCHEMA_VERSION) {
+        fprintf(stderr, "Unsupported model schema version\n");
+        return 1;
+    }
+    resolver.AddDepthwiseConv2D();
+    resolver.AddFullyConnected();
+    resolver.AddSoftmax();
+    resolver.AddReshape();
+
+    tflite::MicroInterpreter interpreter(model, resolver, tensor_arena, TENSOR_ARENA_SIZE, &reporter, &profiler);
+
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+        fprintf(stderr, "AllocateTensors() failed\n");
+        return 1;
+    }
+    init_stage_timer();
+
+    int8_t *input = interpreter.input(0)->data.int8;
+    uint32_t seed = 1;
+
+    for (long i = 0; i < invocations; ++i) {
+        for (size_t k = 0; k < FEATURE_ELEMENT_COUNT; ++k) {
+            seed = seed * 1664525 + 1013904223;
+            input[k] = seed >> 24;
+        }
+        if (interpreter.Invoke() != kTfLiteOk) {
+            fprintf(stderr, "Invoke() failed\n");
+            return 1;
+        }
+    }
+    profiler.print();
+    return 0;
+}
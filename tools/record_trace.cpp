@@ -0,0 +1,171 @@
+// Runs recorded audio through the same frontend and model as the device, once, and
+// saves every model output as a binary trace (see trace.h). Recognizer settings can
+// then be tuned on the trace with eval_recognizer or sweep_recognizer, without
+// running audio again. Build on the host against TFLM and run from the repo root:
+//
+//   g++ -std=c++14 -I include -I <tflite-micro> -I <flatbuffers> tools/record_trace.cpp
+//       src/audio_provider.cpp src/audio_source_file.cpp src/voice_activity.cpp
+//       src/feature_provider.cpp src/features_generator.cpp src/features_quantizer.cpp
+//       src/frontend_config.cpp src/frontend_fft.cpp src/stage_timer.cpp <tflite-micro library>
+//       -o record_trace
+//   ./record_trace [-t tick_ms] [-k keywords.txt] audio.wav out.trace
+//
+// The model runs every tick_ms of audio, 200 by default like the device, at most the
+// 496 ms of capture history the frontend can read at once. Keywords are
+// optional annotations, one per line: <start_ms> <label> [<end_ms>]. Unlike the
+// device, the model also runs while the VAD hears nothing.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <tensorflow/lite/micro/micro_error_reporter.h>
+#include <tensorflow/lite/micro/micro_interpreter.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+#include <tensorflow/lite/version.h>
+
+#include "audio_provider.h"
+#include "audio_source_file.h"
+#include "feature_provider.h"
+#include "model.h"
+#include "trace.h"
+
+namespace {
+
+// A tick's audio must fit what FeatureProvider can still read from the capture ring,
+// one block clear of the producer. Beyond that, every tick overruns the ring and the
+// frontend restarts on silent slices.
+constexpr size_t max_tick_samples = AUDIO_CAPTURE_SAMPLES - AUDIO_BLOCK_SAMPLES;
+
+bool load_keywords(const char *path, Trace &trace)
+{
+    FILE *file = fopen(path, "r");
+
+    if (!file) {
+        fprintf(stderr, "Can't open %s\n", path);
+        return false;
+    }
+    char line[256];
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), file)) {
+        long long start, end;
+        char name[32];
+        const int fields = sscanf(line, "%lld %31s %lld", &start, name, &end);
+
+        if (fields <= 0 || line[0] == '#')
+            continue;
+        if (fields == 2)
+            end = start;
+
+        size_t label = 0;
+        while (label < N_LABELS && strcmp(name, LABELS[label]))
+            ++label;
+
+        ok = fields >= 2 && label < N_LABELS && end >= start;
+        if (ok)
+            trace.keywords.push_back({ms_to_samples(start), static_cast<uint8_t>(label), ms_to_samples(end)});
+        else
+            fprintf(stderr, "Bad keyword line: %s", line);
+    }
+    fclose(file);
+    return ok;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    size_t tick_ms = 200;
+    Trace trace;
+    int arg = 1;
+
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (!strcmp(argv[arg], "-t"))
+            tick_ms = strtoul(argv[arg + 1], nullptr, 10);
+        else if (strcmp(argv[arg], "-k"))
+            break;
+        else if (!load_keywords(argv[arg + 1], trace))
+            return 1;
+    }
+    if (argc - arg != 2 || !tick_ms) {
+        fprintf(stderr, "Usage: %s [-t tick_ms] [-k keywords.txt] audio.wav out.trace\n", argv[0]);
+        return 1;
+    }
+    if (static_cast<size_t>(ms_to_samples(tick_ms)) > max_tick_samples) {
+        fprintf(stderr, "A tick can be at most %ld ms, the capture history\n", static_cast<long>(samples_to_ms(max_tick_samples)));
+        return 1;
+    }
+    FILE *audio = fopen(argv[arg], "rb");
+
+    if (!audio) {
+        fprintf(stderr, "Can't open %s\n", argv[arg]);
+        return 1;
+    }
+    // Each poll of the source produces one tick of audio.
+    FileAudioSource source(audio, FileAudioSource::Format::WAV, FileAudioSource::Pacing::FAST, ms_to_samples(tick_ms));
+
+    static tflite::MicroErrorReporter reporter;
+    static uint8_t tensor_arena[TENSOR_ARENA_SIZE];
+    static tflite::MicroMutableOpResolver<4> resolver(&reporter);
+    static int8_t features[FEATURE_ELEMENT_COUNT];
+
+    const tflite::Model *model = tflite::GetModel(g_model);
+
+    if (model->version() != TFLITE_SCHEMA_VERSION) {
+        fprintf(stderr, "Unsupported model schema version\n");
+        return 1;
+    }
+    resolver.AddDepthwiseConv2D();
+    resolver.AddFullyConnected();
+    resolver.AddSoftmax();
+    resolver.AddReshape();
+
+    tflite::MicroInterpreter interpreter(model, resolver, tensor_arena, TENSOR_ARENA_SIZE, &reporter);
+
+    if (interpreter.AllocateTensors() != kTfLiteOk) {
+        fprintf(stderr, "AllocateTensors() failed\n");
+        return 1;
+    }
+    FeatureProvider provider(features);
+
+    if (init_micro_features() != kTfLiteOk || init_audio_recording(source) != kTfLiteOk) {
+        fprintf(stderr, "Frontend or audio initialization failed\n");
+        return 1;
+    }
+
+    while (true) {
+        const bool last = source.finished();
+        const int64_t current_sample = get_latest_audio_sample();
+        const int new_slices = provider.populate_feature_data(current_sample);
+
+        if (new_slices < 0) {
+            fprintf(stderr, "FeatureProvider::populate_feature_data() failed\n");
+            return 1;
+        }
+        if (new_slices) {
+            provider.copy_to(interpreter.input(0)->data.int8);
+            if (interpreter.Invoke() != kTfLiteOk) {
+                fprintf(stderr, "Invoke() failed\n");
+                return 1;
+            }
+            TraceResult result = {current_sample, {}};
+            memcpy(result.scores, interpreter.output(0)->data.int8, N_LABELS);
+            trace.results.push_back(result);
+        }
+        if (last)
+            break;
+    }
+
+    FILE *out = fopen(argv[arg + 1], "wb");
+
+    if (!out || !save_trace(out, trace)) {
+        fprintf(stderr, "Can't write %s\n", argv[arg + 1]);
+        return 1;
+    }
+    fclose(out);
+    printf("%zu results, %zu keywords, %ld ms of audio\n",
+        trace.results.size(), trace.keywords.size(), static_cast<long>(samples_to_ms(get_latest_audio_sample())));
+    return 0;
+}
\ No newline at end of file
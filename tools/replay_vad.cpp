@@ -0,0 +1,140 @@
+// Replays recorded audio through the capture path and the VAD of the device and
+// counts how much of the frontend and model work the gate skips. Build on the host
+// and run from the repo root:
+//
+//   g++ -std=c++14 -O2 -I include -I <tflite-micro> tools/replay_vad.cpp src/audio_provider.cpp
+//       src/audio_source_file.cpp src/voice_activity.cpp -o replay_vad
+//   ./replay_vad [-r] [-t tick_ms] [-f stride_us] [-i invoke_us] audio.wav
+//   sox in.flac -t raw -r 16000 -c 1 -b 16 -e signed - | ./replay_vad -r -
+//
+// The audio is a 16 kHz mono 16-bit WAV file, or raw little-endian PCM with -r. A path
+// of - reads stdin. It is replayed as fast as it can be polled, and the replay rate
+// against real time is reported, for the capture path and the VAD only.
+// The model runs every tick_ms of audio, 200 by default like the device. The gate is
+// checked every stride, like FeatureStage does. Only the TFLM headers are needed,
+// nothing runs the frontend or the model here. To turn skipped work into CPU time,
+// pass what a stride of the frontend and an Invoke() take on the device, as shown by
+// the 's' serial command.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "audio_provider.h"
+#include "audio_source_file.h"
+#include "misc.h"
+
+namespace {
+
+// Same gate as FeatureStage::process().
+constexpr uint32_t vad_window = FEATURE_SLICE_COUNT * FEATURE_SLICE_STRIDE_SAMPLES;
+// Once voice is back, FeatureProvider streams what of the skipped audio is still in the
+// capture ring through the frontend.
+constexpr uint64_t catch_up_strides = (AUDIO_CAPTURE_SAMPLES - AUDIO_BLOCK_SAMPLES) / FEATURE_SLICE_STRIDE_SAMPLES;
+
+}
+
+int main(int argc, char **argv)
+{
+    size_t tick_ms = 200;
+    double stride_us = 0;
+    double invoke_us = 0;
+    auto format = FileAudioSource::Format::WAV;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "rt:f:i:")) != -1) {
+        switch (opt) {
+        case 'r':
+            format = FileAudioSource::Format::RAW;
+            break;
+        case 't':
+            tick_ms = strtoul(optarg, nullptr, 10);
+            break;
+        case 'f':
+            stride_us = strtod(optarg, nullptr);
+            break;
+        case 'i':
+            invoke_us = strtod(optarg, nullptr);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-r] [-t tick_ms] [-f stride_us] [-i invoke_us] audio.wav|-\n", argv[0]);
+            return 1;
+        }
+    }
+    const size_t tick_samples = ms_to_samples(tick_ms);
+
+    if (argc - optind != 1 || tick_samples < FEATURE_SLICE_STRIDE_SAMPLES) {
+        fprintf(stderr, "Usage: %s [-r] [-t tick_ms] [-f stride_us] [-i invoke_us] audio.wav|-\n", argv[0]);
+        return 1;
+    }
+    FILE *audio = strcmp(argv[optind], "-") ? fopen(argv[optind], "rb") : stdin;
+
+    if (!audio) {
+        fprintf(stderr, "Can't open %s\n", argv[optind]);
+        return 1;
+    }
+    // Each poll of the source produces one stride of audio.
+    FileAudioSource source(audio, format, FileAudioSource::Pacing::FAST, FEATURE_SLICE_STRIDE_SAMPLES);
+    const auto start = std::chrono::steady_clock::now();
+
+    if (init_audio_recording(source) != kTfLiteOk) {
+        fprintf(stderr, "Audio initialization failed\n");
+        return 1;
+    }
+    const size_t tick_strides = tick_samples / FEATURE_SLICE_STRIDE_SAMPLES;
+    uint64_t strides = 0;
+    uint64_t skipped_strides = 0;
+    uint64_t ticks = 0;
+    uint64_t skipped_ticks = 0;
+    uint64_t voice_strides = 0;     // Strides in which the VAD heard voice at all.
+    uint64_t caught_up_strides = 0;
+    uint64_t skip_run = 0;
+    int64_t next_stride = FEATURE_SLICE_STRIDE_SAMPLES;
+
+    // Blocks and strides don't line up, a poll completes zero, one or two strides.
+    while (!source.finished()) {
+        const int64_t sample = get_latest_audio_sample();
+
+        for (; next_stride <= sample; next_stride += FEATURE_SLICE_STRIDE_SAMPLES) {
+            const uint32_t silent = get_silent_samples();
+            const bool skip = silent >= vad_window;
+
+            voice_strides += silent < FEATURE_SLICE_STRIDE_SAMPLES;
+            skipped_strides += skip;
+            if (!skip && skip_run)
+                caught_up_strides += skip_run < catch_up_strides ? skip_run : catch_up_strides;
+            skip_run = skip ? skip_run + 1 : 0;
+
+            if (++strides % tick_strides == 0) {
+                ++ticks;
+                skipped_ticks += skip;
+            }
+        }
+    }
+    const double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!ticks) {
+        fprintf(stderr, "Not enough audio\n");
+        return 1;
+    }
+    const double audio_seconds = static_cast<double>(strides * FEATURE_SLICE_STRIDE_SAMPLES) / AUDIO_SAMPLE_FREQUENCY;
+
+    printf("%.1f s of audio, %llu strides, %llu ticks of %u ms\n", audio_seconds, static_cast<unsigned long long>(strides),
+        static_cast<unsigned long long>(ticks), static_cast<unsigned>(tick_ms));
+    printf("replayed in %.3f s:   %.0fx real time\n", wall_seconds, audio_seconds / wall_seconds);
+    printf("strides with voice:   %5.1f%%\n", 100.0 * voice_strides / strides);
+    printf("strides skipped:      %5.1f%%\n", 100.0 * skipped_strides / strides);
+    printf("ticks skipped:        %5.1f%%\n", 100.0 * skipped_ticks / ticks);
+    printf("strides caught up:    %5.1f%%\n", 100.0 * caught_up_strides / strides);
+
+    if (stride_us > 0 || invoke_us > 0) {
+        const double busy_us = strides * stride_us + ticks * invoke_us;
+        const double gated_us = (strides - skipped_strides + caught_up_strides) * stride_us + (ticks - skipped_ticks) * invoke_us;
+
+        printf("CPU without gate:     %5.1f%%\n", 100 * busy_us / (audio_seconds * 1e6));
+        printf("CPU with gate:        %5.1f%%\n", 100 * gated_us / (audio_seconds * 1e6));
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Runs a producer thread against a consumer on the capture ring faster than real time
+// and checks what the feature stage relies on: every window that intact() accepts
+// holds consecutive samples, and every window the producer overwrote while it was
+// read is rejected. Build on the host and run from the repo root:
+//
+//   g++ -std=c++14 -O2 -pthread -I include -I <tflite-micro> tools/stress_capture_ring.cpp
+//       -o stress_capture_ring
+//   ./stress_capture_ring [-x speed] [-d seconds] [-s stall_ms]
+//
+// The producer writes blocks at speed times the device's rate, 0 writes them as fast
+// as it can, which also wraps the 32-bit sequence numbers after about 4.3e9 samples.
+// The consumer reads feature windows like the device and every 64 windows stalls for
+// stall_ms in the middle of a read, to make the producer overwrite it. Every sample
+// holds the low bits of its own sequence number. Exits with 1 on any failed check.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+
+#include "audio_provider.h"
+#include "capture_ring.h"
+#include "model_settings.h"
+
+namespace {
+
+CaptureRing<int16_t, AUDIO_CAPTURE_SAMPLES> ring;
+std::atomic<bool> producing{true};
+
+constexpr size_t stall_period = 64;
+
+struct Options {
+    double speed = 4;
+    double seconds = 60;
+    long stall_ms = 0;
+};
+
+struct Results {
+    uint64_t windows = 0;           // Accepted windows.
+    uint64_t rejected = 0;          // Windows intact() turned down.
+    uint64_t rejected_torn = 0;     // Rejected windows that really were overwritten.
+    uint64_t undetected = 0;        // Accepted windows with samples out of sequence.
+    uint64_t sequence_errors = 0;   // write_sequence64() disagreeing with write_sequence().
+    uint64_t stalls = 0;            // Stalls that began while the producer was running.
+};
+
+void produce(const Options &options)
+{
+    const uint64_t blocks = options.seconds * AUDIO_SAMPLE_FREQUENCY / AUDIO_BLOCK_SAMPLES;
+    const auto period = std::chrono::duration<double>(AUDIO_BLOCK_SAMPLES / (AUDIO_SAMPLE_FREQUENCY * options.speed));
+    auto next = std::chrono::steady_clock::now();
+    uint32_t seq = 0;
+
+    for (uint64_t i = 0; i < blocks; ++i) {
+        int16_t *block = ring.prepare(AUDIO_BLOCK_SAMPLES);
+
+        for (size_t k = 0; k < AUDIO_BLOCK_SAMPLES; ++k)
+            block[k] = static_cast<int16_t>(seq + k);
+        ring.commit(AUDIO_BLOCK_SAMPLES);
+        seq += AUDIO_BLOCK_SAMPLES;
+
+        if (options.speed > 0) {
+            next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+            std::this_thread::sleep_until(next);
+        }
+    }
+    producing = false;
+}
+
+void consume(const Options &options, Results &results)
+{
+    static int16_t window[FEATURE_SLICE_DURATION_SAMPLES];
+    uint32_t seq = 0;
+    uint64_t reads = 0;
+    uint64_t last_seq64 = 0;
+
+    while (true) {
+        // Checked before the ring, so that once it's false everything has been written.
+        const bool done = !producing;
+
+        // The 64-bit count must never go back, and agree with the 32-bit one around it.
+        const uint32_t before = ring.write_sequence();
+        const uint64_t seq64 = ring.write_sequence64();
+        const uint32_t after = ring.write_sequence();
+
+        if (seq64 < last_seq64 || static_cast<uint32_t>(seq64) - before > after - before)
+            ++results.sequence_errors;
+        last_seq64 = seq64;
+
+        if (!ring.readable(seq, FEATURE_SLICE_DURATION_SAMPLES)) {
+            // Already overwritten: resume from the newest full window, like the device.
+            // A fast producer may have finished before the first read, which still
+            // gets to read the last window then.
+            if (ring.write_sequence() - seq > ring.capacity()) {
+                ring.note_overrun();
+                seq = ring.write_sequence() - FEATURE_SLICE_DURATION_SAMPLES;
+            } else if (done) {
+                break;
+            } else {
+                std::this_thread::yield();
+            }
+            continue;
+        }
+        for (size_t k = 0; k < FEATURE_SLICE_DURATION_SAMPLES; ++k) {
+            window[k] = *ring.at(seq + k);
+            if (options.stall_ms && k == FEATURE_SLICE_DURATION_SAMPLES / 2 && ++reads % stall_period == 0) {
+                results.stalls += producing;
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.stall_ms));
+            }
+        }
+        const bool intact = ring.intact(seq);
+        size_t wrong = 0;
+
+        for (size_t k = 0; k < FEATURE_SLICE_DURATION_SAMPLES; ++k)
+            wrong += window[k] != static_cast<int16_t>(seq + k);
+
+        if (!intact) {
+            ++results.rejected;
+            results.rejected_torn += wrong != 0;
+            ring.note_overrun();
+            seq = ring.write_sequence() - FEATURE_SLICE_DURATION_SAMPLES;
+            continue;
+        }
+        ++results.windows;
+        results.undetected += wrong != 0;
+        seq += FEATURE_SLICE_STRIDE_SAMPLES;
+        ring.release(seq);
+    }
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    Options options;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "x:d:s:")) != -1) {
+        switch (opt) {
+        case 'x':
+            options.speed = strtod(optarg, nullptr);
+            break;
+        case 'd':
+            options.seconds = strtod(optarg, nullptr);
+            break;
+        case 's':
+            options.stall_ms = strtol(optarg, nullptr, 10);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-x speed] [-d seconds] [-s stall_ms]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (options.speed < 0 || options.seconds <= 0 || options.stall_ms < 0) {
+        fprintf(stderr, "Usage: %s [-x speed] [-d seconds] [-s stall_ms]\n", argv[0]);
+        return 1;
+    }
+    Results results;
+    const auto start = std::chrono::steady_clock::now();
+
+    std::thread producer(produce, std::cref(options));
+    consume(options, results);
+    producer.join();
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%.0f s of audio in %.2f s, %llu samples written\n", options.seconds, elapsed,
+        static_cast<unsigned long long>(ring.write_sequence64()));
+    printf("windows accepted:     %llu\n", static_cast<unsigned long long>(results.windows));
+    printf("windows rejected:     %llu (%llu torn)\n", static_cast<unsigned long long>(results.rejected),
+        static_cast<unsigned long long>(results.rejected_torn));
+    printf("overruns:             %u\n", static_cast<unsigned>(ring.overrun_count()));
+    printf("dropped blocks:       %u\n", static_cast<unsigned>(ring.dropped_block_count()));
+    printf("stalls:               %llu\n", static_cast<unsigned long long>(results.stalls));
+    printf("undetected overwrite: %llu\n", static_cast<unsigned long long>(results.undetected));
+    printf("sequence errors:      %llu\n", static_cast<unsigned long long>(results.sequence_errors));
+
+    bool ok = !results.undetected && !results.sequence_errors && results.windows;
+
+    // With stalls longer than the ring holds, overwrites must have been seen and caught.
+    if (results.stalls && (!options.speed || options.stall_ms * AUDIO_SAMPLES_PER_MS * options.speed > AUDIO_CAPTURE_SAMPLES) && !results.rejected_torn)
+        ok = false;
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+// Replays traces (see trace.h) through the recognizer for every combination of the
+// parameters below, on all cores, and prints a CSV line per combination with its
+// false reject rate and false accepts per hour. Combinations on the ROC front, where
+// no other one has both fewer false rejects and fewer false accepts, are marked.
+// Build on the host against the TFLM headers:
+//
+//   g++ -std=c++14 -O2 -pthread -I include -I <tflite-micro> tools/sweep_recognizer.cpp
+//       src/recognizer.cpp -o sweep_recognizer
+//   ./sweep_recognizer [-j threads] [-p profile] [-s average|ewma|hmm] [-e] trace...
+//
+// Other parameters come from the profile (0 balanced, 1 low latency, 2 low false
+// accept), -s overrides its smoothing and -e turns early trigger on.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "trace.h"
+
+namespace {
+
+// Keyword threshold, applied to all keywords alike, in score steps.
+constexpr uint8_t threshold_min = 130;
+constexpr uint8_t threshold_max = 250;
+constexpr uint8_t threshold_step = 5;
+constexpr int64_t windows_ms[] = {500, 750, 1000, 1250};
+constexpr int64_t suppressions_ms[] = {500, 1000, 1500, 2000};
+constexpr int32_t min_counts[] = {1, 2, 3, 4, 5};
+
+constexpr size_t num_thresholds = (threshold_max - threshold_min) / threshold_step + 1;
+constexpr size_t num_windows = sizeof(windows_ms) / sizeof(windows_ms[0]);
+constexpr size_t num_suppressions = sizeof(suppressions_ms) / sizeof(suppressions_ms[0]);
+constexpr size_t num_min_counts = sizeof(min_counts) / sizeof(min_counts[0]);
+constexpr size_t num_points = num_thresholds * num_windows * num_suppressions * num_min_counts;
+
+struct Point {
+    RecognizerConfig config;
+    Evaluation eval;
+    bool front;
+};
+
+RecognizerConfig point_config(const RecognizerConfig &base, size_t idx)
+{
+    RecognizerConfig config = base;
+
+    config.min_count = min_counts[idx % num_min_counts];
+    idx /= num_min_counts;
+    config.suppression = ms_to_samples(suppressions_ms[idx % num_suppressions]);
+    idx /= num_suppressions;
+    config.avg_window_duration = ms_to_samples(windows_ms[idx % num_windows]);
+    idx /= num_windows;
+    for (size_t i = ON; i < N_LABELS; ++i)
+        config.thresholds[i] = threshold_min + idx * threshold_step;
+
+    return config;
+}
+
+double false_reject_rate(const Evaluation &eval)
+{
+    return 1 - eval.hit_rate();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    static constexpr const char *smoothing_names[] = {"average", "ewma", "hmm"};
+
+    size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    RecognizerConfig base = RECOGNIZER_PROFILES[BALANCED];
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+        if (!strcmp(argv[arg], "-e")) {
+            base.early_trigger = true;
+        } else if (!strcmp(argv[arg], "-j") && arg + 1 < argc) {
+            num_threads = std::max(1ul, strtoul(argv[++arg], nullptr, 10));
+        } else if (!strcmp(argv[arg], "-p") && arg + 1 < argc) {
+            const size_t profile = strtoul(argv[++arg], nullptr, 10);
+            if (profile >= N_PROFILES)
+                break;
+            const bool early = base.early_trigger;
+            base = RECOGNIZER_PROFILES[profile];
+            base.early_trigger |= early;
+        } else if (!strcmp(argv[arg], "-s") && arg + 1 < argc) {
+            size_t i = 0;
+            ++arg;
+            while (i < 3 && strcmp(argv[arg], smoothing_names[i]))
+                ++i;
+            if (i == 3)
+                break;
+            base.smoothing = static_cast<Smoothing>(i);
+        } else {
+            break;
+        }
+    }
+    if (arg == argc || argv[arg][0] == '-') {
+        fprintf(stderr, "Usage: %s [-j threads] [-p profile] [-s average|ewma|hmm] [-e] trace...\n", argv[0]);
+        return 1;
+    }
+    std::vector<Trace> traces;
+
+    for (; arg < argc; ++arg) {
+        FILE *file = fopen(argv[arg], "rb");
+
+        if (!file) {
+            fprintf(stderr, "Can't open %s\n", argv[arg]);
+            return 1;
+        }
+        traces.emplace_back();
+        const bool loaded = load_trace(file, traces.back());
+        fclose(file);
+        if (!loaded)
+            return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Point> points(num_points);
+    std::atomic<size_t> next_point{0};
+    std::vector<std::thread> workers;
+
+    // Points are independent and traces are only read, so workers just pull indices.
+    for (size_t t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&] {
+            for (size_t idx; (idx = next_point++) < num_points; ) {
+                Point &point = points[idx];
+
+                point.config = point_config(base, idx);
+                if (!valid_config(point.config))
+                    continue;
+                for (const auto &trace : traces) {
+                    Recognizer recognizer(point.config);
+                    point.eval += evaluate(recognizer, trace);
+                }
+            }
+        });
+    }
+    for (auto &it : workers)
+        it.join();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // ROC front: sorted by false accepts, a point is on it if it rejects less than
+    // everything with fewer false accepts.
+    std::vector<size_t> order(num_points);
+
+    for (size_t i = 0; i < num_points; ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const double fa = points[a].eval.false_accepts_per_hour();
+        const double fb = points[b].eval.false_accepts_per_hour();
+        return fa != fb ? fa < fb : false_reject_rate(points[a].eval) < false_reject_rate(points[b].eval);
+    });
+    double best_frr = 2;
+
+    for (size_t i : order) {
+        if (!valid_config(points[i].config))
+            continue;
+        points[i].front = false_reject_rate(points[i].eval) < best_frr;
+        if (points[i].front)
+            best_frr = false_reject_rate(points[i].eval);
+    }
+
+    printf("threshold,window_ms,suppression_ms,min_count,keywords,hits,false_reject_rate,false_accepts,false_accepts_per_hour,mean_latency_ms,roc_front\n");
+    for (size_t i : order) {
+        const Point &point = points[i];
+
+        if (!valid_config(point.config))
+            continue;
+        printf("%u,%ld,%ld,%ld,%zu,%zu,%.4f,%zu,%.3f,%.1f,%d\n",
+            point.config.thresholds[ON],
+            static_cast<long>(samples_to_ms(point.config.avg_window_duration)),
+            static_cast<long>(samples_to_ms(point.config.suppression)),
+            static_cast<long>(point.config.min_count),
+            point.eval.keywords, point.eval.hits, false_reject_rate(point.eval),
+            point.eval.false_accepts, point.eval.false_accepts_per_hour(), point.eval.mean_latency_ms(),
+            point.front);
+    }
+    fprintf(stderr, "%zu combinations over %zu traces in %.2f s on %zu threads\n", 
+        num_points, traces.size(), seconds, num_threads);
+    return 0;
+}
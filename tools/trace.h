@@ -0,0 +1,260 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "recognizer.h"
+
+#pragma once
+
+// Recorded model output. Traces are either binary, as written by record_trace, or
+// text for hand-made ones, one line per entry, '#' starts a comment:
+//   r <sample> <score>...      result of the model (or of a skipped tick), N_LABELS int8 scores
+//   k <start> <label> [<end>]  annotated spoken keyword, label by name, samples it spans
+// The binary format is a header of the magic, a u16 version and a u16 label count,
+// then records of a tag byte and little-endian fields in the same order as above:
+//   'r' i64 sample, i8 scores[labels]
+//   'k' i64 start, u8 label, i64 end
+struct TraceResult {
+    int64_t sample;
+    int8_t scores[N_LABELS];
+};
+
+struct TraceKeyword {
+    int64_t sample;
+    uint8_t label;
+    int64_t end;    // Same as sample if the end wasn't annotated.
+};
+
+struct Trace {
+    std::vector<TraceResult> results;
+    std::vector<TraceKeyword> keywords;
+};
+
+constexpr char TRACE_MAGIC[4] = {'V', 'C', 'T', 'R'};
+constexpr uint16_t TRACE_VERSION = 1;
+
+namespace trace_detail {
+
+inline void put_le(std::string &out, uint64_t val, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+        out.push_back(static_cast<char>(val >> (8 * i)));
+}
+
+inline bool get_le(const std::string &in, size_t &pos, uint64_t &val, size_t size)
+{
+    if (in.size() - pos < size)
+        return false;
+    val = 0;
+    for (size_t i = 0; i < size; ++i)
+        val |= static_cast<uint64_t>(static_cast<uint8_t>(in[pos + i])) << (8 * i);
+    pos += size;
+    return true;
+}
+
+inline bool parse_binary(const std::string &data, Trace &trace)
+{
+    size_t pos = sizeof(TRACE_MAGIC);
+    uint64_t version, labels;
+
+    if (!get_le(data, pos, version, 2) || !get_le(data, pos, labels, 2) || 
+        version != TRACE_VERSION || labels != N_LABELS) 
+    {
+        fprintf(stderr, "Unsupported trace version or label count\n");
+        return false;
+    }
+    while (pos < data.size()) {
+        const char tag = data[pos++];
+        uint64_t sample, label, end;
+
+        if (tag == 'r' && get_le(data, pos, sample, 8) && data.size() - pos >= N_LABELS) {
+            TraceResult result = {static_cast<int64_t>(sample), {}};
+            memcpy(result.scores, &data[pos], N_LABELS);
+            pos += N_LABELS;
+            trace.results.push_back(result);
+        } else if (tag == 'k' && get_le(data, pos, sample, 8) && get_le(data, pos, label, 1) && 
+            get_le(data, pos, end, 8) && label < N_LABELS) 
+        {
+            trace.keywords.push_back({static_cast<int64_t>(sample), static_cast<uint8_t>(label), static_cast<int64_t>(end)});
+        } else {
+            fprintf(stderr, "Bad trace record at byte %zu\n", pos - 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool parse_text_line(const char *p, Trace &trace)
+{
+    int consumed;
+    long long sample;
+
+    while (*p == ' ' || *p == '\t')
+        ++p;
+    if (*p == '#' || *p == '\r' || !*p)
+        return true;
+
+    if (p[0] == 'r' && sscanf(p + 1, "%lld%n", &sample, &consumed) == 1) {
+        TraceResult result = {sample, {}};
+        p += 1 + consumed;
+
+        size_t i = 0;
+        for (int score; i < N_LABELS && sscanf(p, "%d%n", &score, &consumed) == 1 && score >= -128 && score <= 127; ++i) {
+            result.scores[i] = score;
+            p += consumed;
+        }
+        if (i == N_LABELS) {
+            trace.results.push_back(result);
+            return true;
+        }
+    } else if (p[0] == 'k' && sscanf(p + 1, "%lld%n", &sample, &consumed) == 1) {
+        char name[32];
+        long long end = sample;
+        const int fields = sscanf(p + 1 + consumed, "%31s %lld", name, &end);
+
+        if (fields >= 1 && end >= sample) {
+            size_t i = 0;
+            while (i < N_LABELS && strcmp(name, LABELS[i]))
+                ++i;
+            if (i < N_LABELS) {
+                trace.keywords.push_back({sample, static_cast<uint8_t>(i), end});
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+inline bool parse_text(const std::string &data, Trace &trace)
+{
+    size_t line_num = 0;
+
+    for (size_t pos = 0; pos < data.size(); ) {
+        size_t end = data.find('\n', pos);
+        if (end == std::string::npos)
+            end = data.size();
+
+        const std::string line = data.substr(pos, end - pos);
+        ++line_num;
+        pos = end + 1;
+
+        if (!parse_text_line(line.c_str(), trace)) {
+            fprintf(stderr, "Bad trace line %zu: %s\n", line_num, line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+inline bool load_trace(FILE *file, Trace &trace)
+{
+    std::string data;
+    char buf[4096];
+
+    for (size_t size; (size = fread(buf, 1, sizeof(buf), file)); )
+        data.append(buf, size);
+
+    if (data.size() >= sizeof(TRACE_MAGIC) && !memcmp(data.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)))
+        return trace_detail::parse_binary(data, trace);
+    return trace_detail::parse_text(data, trace);
+}
+
+inline bool save_trace(FILE *file, const Trace &trace)
+{
+    using trace_detail::put_le;
+
+    std::string data(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+
+    put_le(data, TRACE_VERSION, 2);
+    put_le(data, N_LABELS, 2);
+    for (const auto &it : trace.keywords) {
+        data.push_back('k');
+        put_le(data, it.sample, 8);
+        put_le(data, it.label, 1);
+        put_le(data, it.end, 8);
+    }
+    for (const auto &it : trace.results) {
+        data.push_back('r');
+        put_le(data, it.sample, 8);
+        data.append(reinterpret_cast<const char*>(it.scores), N_LABELS);
+    }
+    return fwrite(data.data(), 1, data.size(), file) == data.size();
+}
+
+// Detection quality of a recognizer over a trace. Labels before first_keyword
+// (silence, unknown) are not keywords, detecting them is neither a hit nor an error.
+struct Evaluation {
+    size_t keywords = 0;
+    size_t hits = 0;
+    size_t false_accepts = 0;
+    int64_t latency_sum = 0;    // Samples from keyword end to detection, over hits. Negative
+    int64_t latency_max = 0;    // when detected before the word ended.
+    int64_t duration = 0;       // Samples covered by the trace.
+
+    // Totals over several traces.
+    Evaluation& operator+=(const Evaluation &other)
+    {
+        if (other.hits && (!hits || other.latency_max > latency_max))
+            latency_max = other.latency_max;
+        keywords += other.keywords;
+        hits += other.hits;
+        false_accepts += other.false_accepts;
+        latency_sum += other.latency_sum;
+        duration += other.duration;
+        return *this;
+    }
+
+    double mean_latency_ms() const  { return hits ? samples_to_ms(latency_sum) / double(hits) : 0; }
+    double hit_rate() const         { return keywords ? double(hits) / keywords : 0; }
+    double false_accepts_per_hour() const 
+    { 
+        return duration ? false_accepts * 3600e3 / samples_to_ms(duration) : 0; 
+    }
+};
+
+// A detection counts as a hit for the oldest unmatched keyword with the same label
+// that started before it and ended at most max_latency before it.
+inline Evaluation evaluate(
+    Recognizer &recognizer, 
+    const Trace &trace, 
+    uint8_t first_keyword = ON,
+    int64_t max_latency = ms_to_samples(2000))
+{
+    Evaluation eval;
+    std::vector<bool> matched(trace.keywords.size());
+
+    for (const auto &it : trace.keywords)
+        eval.keywords += it.label >= first_keyword;
+
+    if (!trace.results.empty())
+        eval.duration = trace.results.back().sample - trace.results.front().sample;
+
+    for (const auto &result : trace.results) {
+        TfLiteStatus status = kTfLiteOk;
+        const Command cmd = recognizer.process_scores(result.scores, result.sample, status);
+
+        if (status != kTfLiteOk || !cmd.is_new || cmd.found_command < first_keyword)
+            continue;
+
+        bool hit = false;
+        for (size_t i = 0; i < trace.keywords.size() && !hit; ++i) {
+            const auto &keyword = trace.keywords[i];
+            const int64_t latency = result.sample - keyword.end;
+
+            if (matched[i] || keyword.label != cmd.found_command || result.sample < keyword.sample || latency > max_latency)
+                continue;
+            if (!eval.hits || latency > eval.latency_max)
+                eval.latency_max = latency;
+            matched[i] = hit = true;
+            eval.latency_sum += latency;
+        }
+        if (hit)
+            ++eval.hits;
+        else
+            ++eval.false_accepts;
+    }
+    return eval;
+}